@@ -0,0 +1,131 @@
+#include	"batch.h"
+
+#include	<stdio.h>
+#include	<chrono>
+#include	<mutex>
+#include	<string>
+
+#include	"target.h"
+#include	"json.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct BatchJob
+{
+	TargetSpec          spec;
+	LengthSearchResult  result;
+	std::string         error;
+	long long           wallTimeMs = 0;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool RunBatch(const char* specPath, const char* outPath, const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options)
+{
+	std::vector<TargetSpec> specs;
+	if (!LoadTargetSpecs(specPath, specs))
+	{
+		return false;
+	}
+
+	std::vector<BatchJob> jobs(specs.size());
+	std::mutex mutex;
+
+	{
+		ThreadPool pool(options.numThreads);
+		printf("Running %d targets, lengths %d to %d on %d threads...\n\n", static_cast<int>(jobs.size()), minInstructions, maxInstructions - 1, pool.size());
+
+		for (int i = 0; i < static_cast<int>(jobs.size()); i++)
+		{
+			jobs[i].spec = specs[i];
+			pool.submit([&, i]()
+			{
+				BatchJob& job = jobs[i];
+
+				// nobody is looking at the programs as they're generated so only keep ones which pass the tests
+				SynthOptions targetOptions = options;
+				targetOptions.target = job.spec.func;
+				targetOptions.simTarget = job.spec.sim;
+				targetOptions.inputDomain = job.spec.domain;
+				targetOptions.useCEGIS = true;
+
+				const auto start = std::chrono::high_resolution_clock::now();
+				try
+				{
+					job.result = SearchLengths(minInstructions, maxInstructions, isa, targetOptions);
+				}
+				catch (z3::exception& e)
+				{
+					job.error = e.msg();
+				}
+
+				const auto delta = std::chrono::high_resolution_clock::now() - start;
+				job.wallTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(delta).count();
+
+				std::lock_guard<std::mutex> lock(mutex);
+				printf("  %-16s %s\n", job.spec.name.c_str(), 
+					!job.error.empty() ? "error" : job.result.length < 0 ? "no solution" : "done");
+				fflush(stdout);
+			});
+		}
+
+		pool.wait();
+	}
+
+	printf("\nResults:\n");
+	printf("  %-16s  length  solve ms  passed\n", "target");
+	for (const BatchJob& job: jobs)
+	{
+		if (job.result.length < 0)
+		{
+			printf("  %-16s  %6s  %8lld  %s\n", job.spec.name.c_str(), "-", job.result.solveTimeMs, job.error.empty() ? "no solution" : job.error.c_str());
+			continue;
+		}
+
+		printf("  %-16s  %6d  %8lld  %d / %d\n", job.spec.name.c_str(), job.result.length, job.result.solveTimeMs, job.result.numPassed, NUM_TESTS);
+	}
+
+	FILE* file = fopen(outPath, "w");
+	if (!file)
+	{
+		printf("Couldn't write results: %s\n", outPath);
+		return false;
+	}
+
+	fprintf(file, "[\n");
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const BatchJob& job = jobs[i];
+		const char* status = 
+			!job.error.empty() ? "error" : 
+			job.result.length > 0 ? "sat" : 
+			job.result.numUnknown > 0 ? "unknown" : "unsat";
+
+		fprintf(file, "  { \"name\": %s, \"source\": %s, \"status\": \"%s\", \"solve_ms\": %lld, \"wall_ms\": %lld",
+			JsonString(job.spec.name).c_str(), JsonString(job.spec.source).c_str(), status, job.result.solveTimeMs, job.wallTimeMs);
+
+		if (!job.error.empty())
+		{
+			fprintf(file, ", \"error\": %s", JsonString(job.error).c_str());
+		}
+
+		if (job.result.length > 0)
+		{
+			fprintf(file, ", \"length\": %d, \"passed\": %d, \"tests\": %d, \"program\": ", job.result.length, job.result.numPassed, NUM_TESTS);
+			job.result.program.printJson(file);
+		}
+
+		fprintf(file, " }%s\n", i + 1 < jobs.size() ? "," : "");
+	}
+
+	fprintf(file, "]\n");
+	fclose(file);
+
+	printf("\nResults written to %s\n", outPath);
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,16 @@
+#ifndef		BATCH_H_HAS_BEEN_INCLUDED
+#define		BATCH_H_HAS_BEEN_INCLUDED
+
+#include	"codegen.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Synthesize every target in a spec file in one process. Each target is a job on the thread pool which searches the
+// lengths in order with CEGIS, a summary is printed and the results are written as JSON to outPath.
+bool RunBatch(const char* specPath, const char* outPath, const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  BATCH_H_HAS_BEEN_INCLUDED
@@ -0,0 +1,193 @@
+#include	"bench.h"
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<algorithm>
+#include	<chrono>
+#include	<string>
+#include	<vector>
+
+#include	"target.h"
+#include	"json.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A fixed corpus of Hacker's Delight style targets, each with the opcodes it may use and the seed it is run with. 
+// Changing an entry invalidates any results recorded for it so add new entries rather than editing existing ones.
+struct BenchmarkTarget
+{
+	const char*         name;
+	const char*         expression;
+	const char*         opcodes;
+	unsigned            seed;
+};
+
+static const BenchmarkTarget BenchmarkTargets[] =
+{
+	{ "abs",            "x >= 0 ? x : -x",              "sub xor shr",          1 },
+	{ "abs_gt",         "x >= 0 ? x : -x",              "set sub xor gt",       2 },
+	{ "nabs",           "x >= 0 ? -x : x",              "sub xor shr",          3 },
+	{ "sign",           "x > 0 ? 1 : (x < 0 ? -1 : 0)", "set sub gt",           4 },
+	{ "max_0",          "max(x, 0)",                    "and and_not shr",      5 },
+	{ "min_0",          "min(x, 0)",                    "and and_not shr",      6 },
+	{ "clamp_0_1",      "x > 0 ? 1 : 0",                "set sub gt",           7 },
+	{ "round_up_8",     "(x + 7) & ~7",                 "set add and",          8 },
+	{ "lowest_bit",     "x & -x",                       "set sub and",          9 },
+	{ "clear_lowest",   "x & (x - 1)",                  "set sub and",          10 },
+};
+
+struct BenchmarkResult
+{
+	const BenchmarkTarget* target = nullptr;
+	int                 length = -1;
+	bool                passed = true;
+	double              memoryMb = 0.0;
+	std::vector<long long> solveTimesMs;
+	std::vector<long long> wallTimesMs;
+	std::string         error;
+};
+
+static long long Median(std::vector<long long> values)
+{
+	std::sort(values.begin(), values.end());
+	return values.empty() ? 0 : values[values.size() / 2];
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool RunBenchmarks(const int numRuns, const char* outPath, const int minInstructions, const int maxInstructions, const SynthOptions& options)
+{
+	std::vector<BenchmarkResult> results;
+
+	printf("Running %d benchmark targets, %d runs each, lengths %d to %d...\n\n", 
+		static_cast<int>(sizeof(BenchmarkTargets) / sizeof(BenchmarkTargets[0])), numRuns, minInstructions, maxInstructions - 1);
+	printf("  %-14s  %-16s  length  min ms  median ms  max ms  wall ms  memory MB\n", "target", "opcodes");
+
+	for (const BenchmarkTarget& target: BenchmarkTargets)
+	{
+		BenchmarkResult result;
+		result.target = &target;
+
+		SynthOptions targetOptions = options;
+		targetOptions.seed = target.seed;
+
+		ISASubset isa;
+		std::string error;
+		if (!ParseTargetExpression(target.expression, targetOptions.target, targetOptions.simTarget, error))
+		{
+			result.error = error;
+		}
+
+		char opcodes[64];
+		strcpy(opcodes, target.opcodes);
+		for (const char* name = strtok(opcodes, " "); name && result.error.empty(); name = strtok(nullptr, " "))
+		{
+			const int opcode = ISA_OpCodeForName(name);
+			if (opcode < 0)
+			{
+				result.error = std::string("unknown opcode ") + name;
+				break;
+			}
+
+			isa.addOpcode(opcode);
+		}
+
+		for (int run = 0; run < numRuns && result.error.empty(); run++)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			try
+			{
+				const LengthSearchResult search = SearchLengths(minInstructions, maxInstructions, isa, targetOptions);
+				result.length = search.length;
+				result.passed = result.passed && search.numPassed == NUM_TESTS;
+				result.memoryMb = std::max(result.memoryMb, search.memoryMb);
+				result.solveTimesMs.push_back(search.solveTimeMs);
+			}
+			catch (z3::exception& e)
+			{
+				result.error = e.msg();
+			}
+
+			const auto delta = std::chrono::high_resolution_clock::now() - start;
+			result.wallTimesMs.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(delta).count());
+		}
+
+		if (!result.error.empty())
+		{
+			printf("  %-14s  %-16s  %s\n", target.name, target.opcodes, result.error.c_str());
+		}
+		else
+		{
+			char length[16];
+			sprintf(length, result.length < 0 ? "-" : result.passed ? "%d" : "%d!", result.length);
+
+			const auto times = std::minmax_element(result.solveTimesMs.begin(), result.solveTimesMs.end());
+			printf("  %-14s  %-16s  %6s  %6lld  %9lld  %6lld  %7lld  %9.1f\n", target.name, target.opcodes, length,
+				*times.first, Median(result.solveTimesMs), *times.second, Median(result.wallTimesMs), result.memoryMb);
+		}
+
+		fflush(stdout);
+		results.push_back(result);
+	}
+
+	if (std::any_of(results.begin(), results.end(), [](const BenchmarkResult& r) { return r.length > 0 && !r.passed; }))
+	{
+		printf("\n  ! the program found at this length failed the random tests\n");
+	}
+
+	if (!outPath)
+	{
+		return true;
+	}
+
+	FILE* file = fopen(outPath, "w");
+	if (!file)
+	{
+		printf("Couldn't write results: %s\n", outPath);
+		return false;
+	}
+
+	fprintf(file, "[\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		fprintf(file, "  { \"name\": %s, \"expression\": %s, \"opcodes\": %s, \"seed\": %u, \"runs\": %d",
+			JsonString(result.target->name).c_str(), JsonString(result.target->expression).c_str(), 
+			JsonString(result.target->opcodes).c_str(), result.target->seed, static_cast<int>(result.solveTimesMs.size()));
+
+		if (!result.error.empty())
+		{
+			fprintf(file, ", \"error\": %s", JsonString(result.error).c_str());
+		}
+		else
+		{
+			fprintf(file, ", \"length\": %d, \"passed\": %s, \"memory_mb\": %.1f, \"solve_ms\": [", 
+				result.length, result.passed ? "true" : "false", result.memoryMb);
+			for (size_t j = 0; j < result.solveTimesMs.size(); j++)
+			{
+				fprintf(file, "%s%lld", j > 0 ? ", " : "", result.solveTimesMs[j]);
+			}
+
+			fprintf(file, "], \"wall_ms\": [");
+			for (size_t j = 0; j < result.wallTimesMs.size(); j++)
+			{
+				fprintf(file, "%s%lld", j > 0 ? ", " : "", result.wallTimesMs[j]);
+			}
+
+			fprintf(file, "]");
+		}
+
+		fprintf(file, " }%s\n", i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(file, "]\n");
+	fclose(file);
+
+	printf("\nResults written to %s\n", outPath);
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,17 @@
+#ifndef		BENCH_H_HAS_BEEN_INCLUDED
+#define		BENCH_H_HAS_BEEN_INCLUDED
+
+#include	"codegen.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Run the length search for each benchmark target numRuns times with the current settings (encoding, CEGIS, 
+// symmetry breaking etc) one after another, so the times are comparable between builds and settings. Prints the
+// shortest length, the min/median/max solve time and Z3's memory use per target and writes them to outPath as JSON.
+bool RunBenchmarks(const int numRuns, const char* outPath, const int minInstructions, const int maxInstructions, const SynthOptions& options);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  BENCH_H_HAS_BEEN_INCLUDED
@@ -0,0 +1,484 @@
+#include	"cache.h"
+
+#include	<stdio.h>
+#include	<errno.h>
+#include	<climits>
+#include	<algorithm>
+
+#ifdef _WIN32
+#include	<windows.h>
+#else
+#include	<fcntl.h>
+#include	<unistd.h>
+#include	<sys/file.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+#endif
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const uint32_t CACHE_MAGIC = 0x47433a5a;     // "Z:CG"
+static const uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader
+{
+	uint32_t            magic = CACHE_MAGIC;
+	uint32_t            version = CACHE_VERSION;
+	uint64_t            isaHash = 0;
+	uint32_t            numRecords = 0;
+	uint32_t            recordSize = sizeof(CacheRecord);
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static uint64_t HashBytes(uint64_t hash, const void* data, const size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The opcode numbers stored in the records are only valid for the ISA table they were written with
+static uint64_t ISAHash()
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (int opcode = 0; opcode < ISA_NumOpCodes(); opcode++)
+	{
+		const char* name = ISA_OpName(opcode);
+		hash = HashBytes(hash, name, strlen(name) + 1);
+	}
+
+	return hash;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// An exclusive lock on path held until it goes out of scope, used so only one process at a time rewrites the cache.
+// It is an advisory lock on a separate file as the cache file itself is replaced by the rename.
+class FileLock
+{
+public:
+
+	explicit FileLock(const std::string& path)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			OVERLAPPED overlapped = {};
+			if (LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped))
+			{
+				handle_ = file;
+			}
+			else
+			{
+				CloseHandle(file);
+			}
+		}
+#else
+		fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		if (fd_ >= 0 && flock(fd_, LOCK_EX) != 0)
+		{
+			close(fd_);
+			fd_ = -1;
+		}
+#endif
+	}
+
+	~FileLock()
+	{
+#ifdef _WIN32
+		if (handle_)
+		{
+			OVERLAPPED overlapped = {};
+			UnlockFileEx(handle_, 0, MAXDWORD, MAXDWORD, &overlapped);
+			CloseHandle(handle_);
+		}
+#else
+		if (fd_ >= 0)
+		{
+			flock(fd_, LOCK_UN);
+			close(fd_);
+		}
+#endif
+	}
+
+	FileLock(const FileLock&) = delete;
+	FileLock& operator=(const FileLock&) = delete;
+
+#ifdef _WIN32
+	bool locked() const { return handle_ != nullptr; }
+#else
+	bool locked() const { return fd_ >= 0; }
+#endif
+
+private:
+
+#ifdef _WIN32
+	void*               handle_ = nullptr;
+#else
+	int                 fd_ = -1;
+#endif
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static bool SameKey(const CacheKey& a, const CacheKey& b)
+{
+	return a.fingerprint == b.fingerprint && a.opcodeMask == b.opcodeMask && a.bitWidth == b.bitWidth;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+CacheKey MakeCacheKey(TargetFn target, const ISASubset& isa, const int bitWidth)
+{
+	// the edge cases followed by a fixed LCG sequence, this must never change or existing caches will be missed
+	const int NUM_CANONICAL_INPUTS = 64;
+	ValueType inputs[NUM_CANONICAL_INPUTS] = { 0, 1, -1, 2, -2, 3, -3, INT_MAX, INT_MIN, INT_MAX - 1, INT_MIN + 1 };
+	uint32_t lcg = 12345;
+	for (int i = 11; i < NUM_CANONICAL_INPUTS; i++)
+	{
+		lcg = lcg * 1664525u + 1013904223u;
+		inputs[i] = static_cast<ValueType>(lcg);
+	}
+
+	CacheKey key;
+	key.bitWidth = bitWidth;
+	key.fingerprint = 14695981039346656037ull;
+	for (const ValueType x: inputs)
+	{
+		const ValueType y = NarrowValue(bitWidth, target(NarrowValue(bitWidth, x)));
+		key.fingerprint = HashBytes(key.fingerprint, &y, sizeof(y));
+	}
+
+	for (int i = 0; i < isa.size(); i++)
+	{
+		key.opcodeMask |= 1u << isa.isaOpCode(i);
+	}
+
+	return key;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+Program CacheRecord::program() const
+{
+	Program program;
+	program.numInputs = 1;
+	program.bitWidth = key.bitWidth;
+	program.resize(length);
+
+	for (int i = program.numInputs; i < length; i++)
+	{
+		program.opcode[i] = opcode[i];
+		program.regX[i] = regX[i];
+		program.regY[i] = regY[i];
+		program.imm[i] = imm[i];
+	}
+
+	return program;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+ResultCache::~ResultCache()
+{
+	unmap();
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void ResultCache::unmap()
+{
+#ifdef _WIN32
+	if (mapping_)
+	{
+		UnmapViewOfFile(mapping_);
+	}
+
+	if (mappingHandle_)
+	{
+		CloseHandle(mappingHandle_);
+	}
+
+	if (fileHandle_)
+	{
+		CloseHandle(fileHandle_);
+	}
+
+	fileHandle_ = nullptr;
+	mappingHandle_ = nullptr;
+#else
+	if (mapping_)
+	{
+		munmap(mapping_, mappingSize_);
+	}
+#endif
+
+	mapping_ = nullptr;
+	mappingSize_ = 0;
+	records_ = nullptr;
+	numRecords_ = 0;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool ResultCache::open(const char* path)
+{
+	unmap();
+	path_ = path;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return GetLastError() == ERROR_FILE_NOT_FOUND;
+	}
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	fileHandle_ = file;
+	mappingSize_ = static_cast<size_t>(size.QuadPart);
+	if (mappingSize_ < sizeof(CacheHeader))
+	{
+		return true;
+	}
+
+	mappingHandle_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	mapping_ = mappingHandle_ ? MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return errno == ENOENT;
+	}
+
+	struct stat st;
+	fstat(fd, &st);
+	mappingSize_ = static_cast<size_t>(st.st_size);
+	if (mappingSize_ < sizeof(CacheHeader))
+	{
+		close(fd);
+		return true;
+	}
+
+	mapping_ = mmap(nullptr, mappingSize_, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping_ == MAP_FAILED)
+	{
+		mapping_ = nullptr;
+	}
+#endif
+
+	if (!mapping_)
+	{
+		unmap();
+		return false;
+	}
+
+	const CacheHeader* header = static_cast<const CacheHeader*>(mapping_);
+	const size_t expectedSize = sizeof(CacheHeader) + static_cast<size_t>(header->numRecords) * sizeof(CacheRecord);
+	const bool valid =
+		header->magic == CACHE_MAGIC && header->version == CACHE_VERSION && header->isaHash == ISAHash() &&
+		header->recordSize == sizeof(CacheRecord) && mappingSize_ >= expectedSize;
+
+	if (valid)
+	{
+		records_ = reinterpret_cast<const CacheRecord*>(header + 1);
+		numRecords_ = static_cast<int>(header->numRecords);
+	}
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+const CacheRecord* ResultCache::lookup(const CacheKey& key) const
+{
+	for (const CacheRecord& record: updated_)
+	{
+		if (SameKey(record.key, key))
+		{
+			return &record;
+		}
+	}
+
+	for (int i = 0; i < numRecords_; i++)
+	{
+		if (SameKey(records_[i].key, key))
+		{
+			return &records_[i];
+		}
+	}
+
+	return nullptr;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+CacheRecord& ResultCache::update(const CacheKey& key)
+{
+	for (CacheRecord& record: updated_)
+	{
+		if (SameKey(record.key, key))
+		{
+			return record;
+		}
+	}
+
+	const CacheRecord* existing = lookup(key);
+	CacheRecord record;
+	if (existing)
+	{
+		record = *existing;
+	}
+
+	record.key = key;
+	updated_.push_back(record);
+	return updated_.back();
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void ResultCache::recordUnsat(const CacheKey& key, const int length)
+{
+	CacheRecord& record = update(key);
+	if (record.length == 0 || length < record.length)
+	{
+		record.unsatLength = std::max(record.unsatLength, static_cast<int32_t>(length));
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void ResultCache::recordProgram(const CacheKey& key, const Program& program)
+{
+	if (program.size() > CacheRecord::MAX_INSTRUCTIONS || program.numInputs != 1)
+	{
+		return;
+	}
+
+	// a program found by a search which skipped shorter lengths (a timeout, a heuristic search, --min) may not be
+	// the shortest, it is only recorded once those lengths are proven unsatisfiable
+	const CacheRecord* known = lookup(key);
+	if (!CacheRecord::isShortest(program.size(), known ? known->unsatLength : 0))
+	{
+		return;
+	}
+
+	CacheRecord& record = update(key);
+	if (record.length != 0 && record.length <= program.size())
+	{
+		return;
+	}
+
+	record.length = program.size();
+	for (int i = program.numInputs; i < program.size(); i++)
+	{
+		record.opcode[i] = static_cast<uint8_t>(program.opcode[i]);
+		record.regX[i] = static_cast<uint8_t>(program.regX[i]);
+		record.regY[i] = static_cast<uint8_t>(program.regY[i]);
+		record.imm[i] = program.imm[i];
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void ResultCache::forgetProgram(const CacheKey& key)
+{
+	CacheRecord& record = update(key);
+	const int32_t unsatLength = record.unsatLength;
+
+	record = CacheRecord();
+	record.key = key;
+	record.unsatLength = unsatLength;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Write the mapped records which haven't changed followed by the updated ones to a temporary file and then replace
+// the cache file with it, so a reader never sees a partially written cache. Other processes may have saved since the
+// file was mapped so it is re-mapped under the lock first, their records are kept and for a key both have updated
+// this process's record wins.
+bool ResultCache::save()
+{
+	if (updated_.empty())
+	{
+		return true;
+	}
+
+	FileLock lock(path_ + ".lock");
+	if (!lock.locked() || !open(path_.c_str()))
+	{
+		return false;
+	}
+
+	std::vector<CacheRecord> records;
+	for (int i = 0; i < numRecords_; i++)
+	{
+		const bool isUpdated = std::any_of(updated_.begin(), updated_.end(),
+			[&](const CacheRecord& record) { return SameKey(record.key, records_[i].key); });
+		if (!isUpdated)
+		{
+			records.push_back(records_[i]);
+		}
+	}
+
+	records.insert(records.end(), updated_.begin(), updated_.end());
+	unmap();
+
+	CacheHeader header;
+	header.isaHash = ISAHash();
+	header.numRecords = static_cast<uint32_t>(records.size());
+
+	const std::string tmpPath = path_ + ".tmp";
+	FILE* file = fopen(tmpPath.c_str(), "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && fwrite(records.data(), sizeof(CacheRecord), records.size(), file) == records.size();
+	ok = fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+	remove(path_.c_str());
+#endif
+	ok = ok && rename(tmpPath.c_str(), path_.c_str()) == 0;
+	if (!ok)
+	{
+		// keep everything in memory so nothing is lost if save() is retried
+		remove(tmpPath.c_str());
+		updated_ = records;
+		return false;
+	}
+
+	updated_.clear();
+	return open(path_.c_str());
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
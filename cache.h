@@ -0,0 +1,111 @@
+#ifndef		CACHE_H_HAS_BEEN_INCLUDED
+#define		CACHE_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+#include	<string>
+
+#include	"isa.h"
+#include	"program.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Identifies a synthesis problem: the target's behaviour, the set of opcodes which can be used and the bit width
+struct CacheKey
+{
+	uint64_t            fingerprint = 0;
+	uint32_t            opcodeMask = 0;
+	int32_t             bitWidth = 32;
+};
+
+// The fingerprint is a hash of the target's outputs on a fixed set of canonical inputs and the opcode mask has a bit
+// set for each ISA[] opcode in the subset, so it doesn't depend on the order the subset was built in
+CacheKey MakeCacheKey(TargetFn target, const ISASubset& isa, const int bitWidth);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// One fixed size record per key, the file is a header followed by an array of these so it can be mapped and used
+// directly without parsing
+struct CacheRecord
+{
+	const static int MAX_INSTRUCTIONS = 16;
+
+	CacheKey            key;
+
+	// every length <= unsatLength is known to be unsatisfiable, 0 if nothing is known
+	int32_t             unsatLength = 0;
+
+	// the length of the shortest verified program, 0 if none has been found
+	int32_t             length = 0;
+
+	uint8_t             opcode[MAX_INSTRUCTIONS] = {};
+	uint8_t             regX[MAX_INSTRUCTIONS] = {};
+	uint8_t             regY[MAX_INSTRUCTIONS] = {};
+	int32_t             imm[MAX_INSTRUCTIONS] = {};
+
+	Program program() const;
+
+	// A program is only known to be the shortest when every shorter length has been proven unsatisfiable. The search
+	// starts with a single instruction (a length of 2 with the input) so a program of that length always is.
+	static bool isShortest(const int length, const int unsatLength)
+	{
+		return length <= 2 || unsatLength >= length - 1;
+	}
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A persistent store of synthesis results. The file is memory mapped when opened so lookups don't read or parse the
+// whole file, updates are held in memory until save() rewrites the file. save() holds a lock on "<path>.lock" so
+// runs sharing a cache don't lose each other's results. Files written with a different ISA table are ignored as the 
+// opcode numbers would not match.
+class ResultCache
+{
+public:
+
+	ResultCache() = default;
+	~ResultCache();
+
+	ResultCache(const ResultCache&) = delete;
+	ResultCache& operator=(const ResultCache&) = delete;
+
+	// Returns false if the file exists but couldn't be mapped, a missing file is treated as an empty cache
+	bool open(const char* path);
+
+	// Returns nullptr if nothing is known about the key
+	const CacheRecord* lookup(const CacheKey& key) const;
+
+	void recordUnsat(const CacheKey& key, const int length);
+	void recordProgram(const CacheKey& key, const Program& program);
+
+	// Drop the program recorded for the key when it turns out to be wrong, the unsatisfiable lengths are kept
+	void forgetProgram(const CacheKey& key);
+
+	bool save();
+
+private:
+
+	CacheRecord& update(const CacheKey& key);
+	void unmap();
+
+	std::string                 path_;
+	void*                       mapping_ = nullptr;
+	size_t                      mappingSize_ = 0;
+#ifdef _WIN32
+	void*                       fileHandle_ = nullptr;
+	void*                       mappingHandle_ = nullptr;
+#endif
+
+	const CacheRecord*          records_ = nullptr;
+	int                         numRecords_ = 0;
+
+	// records which have been added or changed since the file was mapped
+	std::vector<CacheRecord>    updated_;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  CACHE_H_HAS_BEEN_INCLUDED
@@ -1,350 +1,2807 @@
+#include	"codegen.h"
+
 #include	<z3++.h>
 #include	<vector>
 #include	<chrono>
 #include	<random>
+#include	<memory>
+#include	<mutex>
+#include	<atomic>
+#include	<condition_variable>
+#include	<climits>
+#include	<algorithm>
+#include	<string>
+#include	<unordered_set>
 
 #include	"isa.h"
+#include	"threadpool.h"
+#include	"program.h"
+#include	"enumerate.h"
+#include	"stochastic.h"
+#include	"cache.h"
+#include	"json.h"
+#include	"stats.h"
+#include	"watchdog.h"
+#include	"inputs.h"
+#include	"workers.h"
+#include	"sketch.h"
+#include	"shard.h"
+#include	"rank.h"
+#include	"portfolio.h"
+#include	"explore.h"
+#include	"batch.h"
+#include	"bench.h"
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-std::mt19937 prng;
-std::uniform_int_distribution<ValueType> rndDist(-INT_MAX - 1, INT_MAX);
+// The targets are written once with Select and Constant and instantiated for native values and for the solver, so 
+// they can be tested natively and also stated for all inputs with --forall
+
+template <typename T>
+inline T Select(const bool cond, const T a, const T b) { return cond ? a : b; }
+inline z3::expr Select(const z3::expr& cond, const z3::expr& a, const z3::expr& b) { return z3::ite(cond, a, b); }
+
+template <typename T>
+inline T Constant(const T, const ValueType v) { return static_cast<T>(v); }
+inline z3::expr Constant(const z3::expr& like, const ValueType v) { return like.ctx().bv_val(v, like.get_sort().bv_size()); }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-ValueType TargetFunc(const ValueType x)
+template <typename T>
+T TargetFunc(const T& x)
 {
-//	return x >= 0 ? x : 1 - x;
-	return x >= 0 ? x : -x;
+//	return Select(x >= 0, x, 1 - x);
+	return Select(x >= 0, x, -x);
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-using expr_vector_array = std::vector<z3::expr_vector>;
+template <typename T> T Target_Abs(const T& x) { return Select(x >= 0, x, -x); }
+template <typename T> T Target_AbsOffset(const T& x) { return Select(x >= 0, x, 1 - x); }
+template <typename T> T Target_NegAbs(const T& x) { return Select(x >= 0, -x, x); }
+template <typename T> T Target_Sign(const T& x) { return Select(x > 0, Constant(x, 1), Select(x < 0, Constant(x, -1), Constant(x, 0))); }
+
+struct BuiltinTarget
+{
+	const char*         name;
+	TargetFn            func;
+	SimTargetFn         sim;
+};
 
-class CodeGenContext
+#define BUILTIN_TARGET(name, fn) { name, fn<ValueType>, fn<z3::expr> }
+
+// TargetFunc is always available as "target", the others are for comparing different search settings
+static const BuiltinTarget BuiltinTargets[] =
 {
-public:
+	BUILTIN_TARGET("target", TargetFunc),
+	BUILTIN_TARGET("abs", Target_Abs),
+	BUILTIN_TARGET("abs_offset", Target_AbsOffset),
+	BUILTIN_TARGET("nabs", Target_NegAbs),
+	BUILTIN_TARGET("sign", Target_Sign),
+};
 
-	CodeGenContext(z3::context& _ctx, const int _numInputs, const int _numChains, const int _numSteps, const ISASubset& _isa)
-		: ctx(_ctx)
-		, solver(_ctx)
-		, numInputs(_numInputs)
-		, numChains(_numChains)
-		, numInstr(_numSteps)
-		, opCode(_ctx)
-		, regX(_ctx)
-		, regY(_ctx)
-		, imm32(_ctx)
-		, isa(_isa)
+const BuiltinTarget* TargetForName(const char* name)
+{
+	for (const auto& target: BuiltinTargets)
 	{
+		if (strcmp(target.name, name) == 0)
+		{
+			return &target;
+		}
 	}
 
-	z3::context&        ctx;
-	z3::solver          solver;
-	int                 numInputs = 0;
-	int                 numChains = 0;
-	int                 numInstr = 0;
-	z3::expr_vector     opCode;
-	z3::expr_vector     regX;
-	z3::expr_vector     regY;
-	z3::expr_vector     imm32;
-	expr_vector_array   R;
-
-	ISASubset           isa;
-};
+	return nullptr;
+}
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-void CreateConstants(CodeGenContext& codeGen)
+// Look a name up in the names of an enum class, which are listed in the same order as its values
+template <typename Enum>
+bool ParseEnumName(const char* name, const char* const names[], const int numNames, Enum& value)
 {
-	for (int c = 0; c < codeGen.numChains; c++)
+	for (int i = 0; i < numNames; i++)
 	{
-		z3::expr_vector chainR(codeGen.ctx);
-		for (int idx = 0; idx < codeGen.numInstr; idx++)
+		if (strcmp(names[i], name) == 0)
 		{
-			char name[16];
-			sprintf(name, "R%d_c%d", idx, c);
-			chainR.push_back(codeGen.ctx.bv_const(name, 32));
+			value = static_cast<Enum>(i);
+			return true;
 		}
+	}
+
+	return false;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const char* IndexEncodingNames[] = { "int", "bv", "onehot" };
+
+bool ParseIndexEncoding(const char* name, IndexEncoding& encoding)
+{
+	return ParseEnumName(name, IndexEncodingNames, sizeof(IndexEncodingNames) / sizeof(IndexEncodingNames[0]), encoding);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const char* ChainEncodingNames[] = { "mux", "location" };
+
+bool ParseChainEncoding(const char* name, ChainEncoding& encoding)
+{
+	return ParseEnumName(name, ChainEncodingNames, sizeof(ChainEncodingNames) / sizeof(ChainEncodingNames[0]), encoding);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const char* CostObjectiveNames[] = { "length", "latency", "throughput" };
+
+bool ParseCostObjective(const char* name, CostObjective& objective)
+{
+	return ParseEnumName(name, CostObjectiveNames, sizeof(CostObjectiveNames) / sizeof(CostObjectiveNames[0]), objective);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const char* InputSelectionNames[] = { "random", "edge", "adaptive" };
+
+bool ParseInputSelection(const char* name, InputSelection& selection)
+{
+	return ParseEnumName(name, InputSelectionNames, sizeof(InputSelectionNames) / sizeof(InputSelectionNames[0]), selection);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const char* SolverPipelineNames[] = { "default", "qfbv", "bitblast", "bitblast-aig", "qfbv-tactic", "auto" };
+
+bool ParseSolverPipeline(const char* name, SolverPipeline& pipeline)
+{
+	return ParseEnumName(name, SolverPipelineNames, sizeof(SolverPipelineNames) / sizeof(SolverPipelineNames[0]), pipeline);
+}
+
+z3::solver CreateSolver(z3::context& ctx, const SolverPipeline pipeline)
+{
+	switch (pipeline)
+	{
+		case SolverPipeline::QFBV:
+			return z3::solver(ctx, "QF_BV");
+
+		case SolverPipeline::BitBlast:
+			return (z3::tactic(ctx, "simplify") & z3::tactic(ctx, "propagate-values") & z3::tactic(ctx, "solve-eqs") & 
+				z3::tactic(ctx, "bit-blast") & z3::tactic(ctx, "sat")).mk_solver();
+
+		case SolverPipeline::BitBlastAIG:
+			return (z3::tactic(ctx, "simplify") & z3::tactic(ctx, "propagate-values") & z3::tactic(ctx, "solve-eqs") & 
+				z3::tactic(ctx, "bit-blast") & z3::tactic(ctx, "aig") & z3::tactic(ctx, "sat")).mk_solver();
+
+		case SolverPipeline::QFBVTactic:
+			return z3::tactic(ctx, "qfbv").mk_solver();
 
-		codeGen.R.push_back(chainR);
+		// Auto is resolved before any solving starts, the modes which don't tune use the default solver
+		default:
+			return z3::solver(ctx);
 	}
+}
+
+IndexEncoding EncodingForPipeline(const IndexEncoding encoding, const SolverPipeline pipeline)
+{
+	const bool bitBlasts = pipeline == SolverPipeline::BitBlast || pipeline == SolverPipeline::BitBlastAIG;
+	return bitBlasts && encoding == IndexEncoding::Int ? IndexEncoding::BitVector : encoding;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void CreateInstructionConstants(CodeGenContext& codeGen, const int idx)
+{
+	char name[16];
+
+	sprintf(name, "opCode_s%d", idx);
+	codeGen.opCode.push_back(IndexVar(codeGen.ctx, name, codeGen.isa.size(), codeGen.encoding));
+
+	sprintf(name, "regX_s%d", idx);
+	codeGen.regX.push_back(IndexVar(codeGen.ctx, name, idx, codeGen.encoding));
+
+	sprintf(name, "regY_s%d", idx);
+	codeGen.regY.push_back(IndexVar(codeGen.ctx, name, idx, codeGen.encoding));
+
+	sprintf(name, "imm32_s%d", idx);
+	codeGen.imm32.push_back(codeGen.ctx.bv_const(name, codeGen.bitWidth));
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void CreateConstants(CodeGenContext& codeGen)
+{
+	ScopedTimer timer(codeGen.phases.createConstantsUs);
 
 	for (int idx = 0; idx < codeGen.numInstr; idx++)
 	{
-		char name[16];
+		CreateInstructionConstants(codeGen, idx);
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
 
-		sprintf(name, "opCode_s%d", idx);
-		codeGen.opCode.push_back(codeGen.ctx.int_const(name));
+// What the sketch knows about instruction idx, nullptr if it is free
+const SketchSlot* SketchSlotFor(const CodeGenContext& codeGen, const int idx)
+{
+	return codeGen.sketch ? codeGen.sketch->slot(idx) : nullptr;
+}
 
-		sprintf(name, "regX_s%d", idx);
-		codeGen.regX.push_back(codeGen.ctx.int_const(name));
+// The local IDs of the opcodes instruction idx can have
+std::vector<int> AllowedOpCodes(CodeGenContext& codeGen, const int idx)
+{
+	std::vector<int> localIDs;
+	const SketchSlot* slot = SketchSlotFor(codeGen, idx);
+	if (!slot || slot->opcodes.empty())
+	{
+		for (int opcodeIdx = 0; opcodeIdx < codeGen.isa.size(); opcodeIdx++)
+		{
+			localIDs.push_back(opcodeIdx);
+		}
 
-		sprintf(name, "regY_s%d", idx);
-		codeGen.regY.push_back(codeGen.ctx.int_const(name));
+		return localIDs;
+	}
 
-		sprintf(name, "imm32_s%d", idx);
-		codeGen.imm32.push_back(codeGen.ctx.bv_const(name, 32));
+	for (const int opcode: slot->opcodes)
+	{
+		const int localID = codeGen.isa.opCodeForName(ISA_OpName(opcode));
+		if (localID >= 0)
+		{
+			localIDs.push_back(localID);
+		}
 	}
+
+	return localIDs;
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-void AddConstraints(CodeGenContext& codeGen)
+// Constrain instruction idx to what the sketch knows about it
+void AddSketchConstraints(CodeGenContext& codeGen, const int idx)
 {
-	codeGen.solver = z3::solver(codeGen.ctx);
+	const SketchSlot* slot = SketchSlotFor(codeGen, idx);
+	if (!slot)
+	{
+		return;
+	}
 
-	for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
+	if (!slot->opcodes.empty())
 	{
-		codeGen.solver.add(codeGen.opCode[idx] >= 0);
-		codeGen.solver.add(codeGen.opCode[idx] < codeGen.isa.size());
+		z3::expr_vector allowed(codeGen.ctx);
+		for (const int opcodeIdx: AllowedOpCodes(codeGen, idx))
+		{
+			allowed.push_back(codeGen.opCode[idx].eq(opcodeIdx));
+		}
+
+		codeGen.solver.add(z3::mk_or(allowed));
+	}
 
-		codeGen.solver.add(codeGen.regX[idx] >= 0);
-		codeGen.solver.add(codeGen.regX[idx] < idx);
+	if (slot->regX >= 0)
+	{
+		codeGen.solver.add(codeGen.regX[idx].eq(slot->regX));
+	}
 
-		codeGen.solver.add(codeGen.regY[idx] >= 0);
-		codeGen.solver.add(codeGen.regY[idx] < idx);
+	if (slot->regY >= 0)
+	{
+		codeGen.solver.add(codeGen.regY[idx].eq(slot->regY));
+	}
 
-		z3::expr_vector shiftConstraints(codeGen.ctx);
-		shiftConstraints.push_back(codeGen.imm32[idx] > 0);
-		shiftConstraints.push_back(codeGen.imm32[idx] <= 31);
-		z3::expr andShiftConstriants = z3::mk_and(shiftConstraints);
+	// the bounds are 32 bit values, a narrowed search leaves the immediate free and the widened program is verified
+	if (slot->boundImm && codeGen.bitWidth == 32)
+	{
+		const auto& imm = codeGen.imm32[idx];
+		codeGen.solver.add(imm >= codeGen.ctx.bv_val(slot->immMin, 32) && imm <= codeGen.ctx.bv_val(slot->immMax, 32));
+	}
 
-		for (const int shiftOpCode: codeGen.isa.opCodesForKindMask(Instruction::Kind_Shift))
+	// an operand the opcode doesn't read can't satisfy the dependency
+	for (const int reg: slot->reads)
+	{
+		z3::expr_vector readers(codeGen.ctx);
+		for (const int opcodeIdx: AllowedOpCodes(codeGen, idx))
 		{
-			codeGen.solver.add(z3::to_expr(codeGen.ctx, z3::implies(codeGen.opCode[idx] == shiftOpCode, andShiftConstriants)));
+			const int arity = codeGen.isa.opArity(opcodeIdx);
+			if (arity >= 1)
+			{
+				readers.push_back(codeGen.opCode[idx].eq(opcodeIdx) && codeGen.regX[idx].eq(reg));
+			}
+
+			if (arity >= 2)
+			{
+				readers.push_back(codeGen.opCode[idx].eq(opcodeIdx) && codeGen.regY[idx].eq(reg));
+			}
 		}
+
+		codeGen.solver.add(z3::mk_or(readers));
 	}
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-z3::expr SelectOperand(CodeGenContext& codeGen, z3::expr_vector& R, const z3::expr& regIdx, const int instructionIdx)
+// Constraints which remove programs that are equivalent to some other program in the search space:
+//  - commutative ops must have regX <= regY
+//  - register operands the opcode doesn't read are fixed at 0
+//  - adjacent instructions where the second doesn't read the first can be swapped so must be sorted by opcode
+// The sketch may fix an operand or an order these would rule out, so they aren't added for what it fixes.
+void AddSymmetryConstraints(CodeGenContext& codeGen, const int idx)
 {
-	z3::expr cond = codeGen.ctx.bv_val(0, 32);
-	for (int i = instructionIdx - 1; i >= 0; i--)
+	const auto& op = codeGen.opCode[idx];
+	const SketchSlot* slot = SketchSlotFor(codeGen, idx);
+	const bool fixedX = slot && slot->regX >= 0;
+	const bool fixedY = slot && slot->regY >= 0;
+	if (!fixedX && !fixedY)
 	{
-		cond = z3::to_expr(codeGen.ctx, z3::ite(regIdx == i, R[i], cond));
+		for (const int opcodeIdx: codeGen.isa.opCodesForKindMask(Instruction::Kind_Commutative))
+		{
+			codeGen.solver.add(z3::implies(op.eq(opcodeIdx), codeGen.regX[idx].lessEq(codeGen.regY[idx])));
+		}
 	}
 
-	return cond;
+	for (int opcodeIdx = 0; opcodeIdx < codeGen.isa.size(); opcodeIdx++)
+	{
+		const int arity = codeGen.isa.opArity(opcodeIdx);
+		if (arity < 1 && !fixedX)
+		{
+			codeGen.solver.add(z3::implies(op.eq(opcodeIdx), codeGen.regX[idx].eq(0)));
+		}
+
+		if (arity < 2 && !fixedY)
+		{
+			codeGen.solver.add(z3::implies(op.eq(opcodeIdx), codeGen.regY[idx].eq(0)));
+		}
+	}
+
+	const int prevIdx = idx - 1;
+	if (prevIdx >= codeGen.numInputs && !slot && !SketchSlotFor(codeGen, prevIdx))
+	{
+		const z3::expr readsPrev = codeGen.regX[idx].eq(prevIdx) || codeGen.regY[idx].eq(prevIdx);
+		codeGen.solver.add(readsPrev || codeGen.opCode[prevIdx].lessEq(op));
+	}
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-void AddPerChainConstraints(CodeGenContext& codeGen)
+// Every instruction except the last must be read by a later instruction. This depends on the program length so
+// is guarded by the output guard.
+void AddDeadCodeConstraints(CodeGenContext& codeGen)
 {
-	for (int c = 0; c < codeGen.numChains; c++)
+	for (int idx = codeGen.numInputs; idx < codeGen.numInstr - 1; idx++)
 	{
-		auto& chainR = codeGen.R[c];
+		z3::expr_vector readers(codeGen.ctx);
+		for (int j = idx + 1; j < codeGen.numInstr; j++)
+		{
+			readers.push_back(codeGen.regX[j].eq(idx));
+			readers.push_back(codeGen.regY[j].eq(idx));
+		}
 
-		const ValueType x = rndDist(prng);
-		const ValueType out = TargetFunc(x);
+		codeGen.solver.add(z3::implies(codeGen.outputGuard, z3::mk_or(readers)));
+	}
+}
 
-		codeGen.solver.add(chainR[0] == codeGen.ctx.bv_val(x, 32));
-		codeGen.solver.add(chainR[codeGen.numInstr - 1] == codeGen.ctx.bv_val(out, 32));
+// ====================================================================================================================
+// ====================================================================================================================
 
-		for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
-		{
-			const auto& op = codeGen.opCode[idx];
-			const auto& x = SelectOperand(codeGen, chainR, codeGen.regX[idx], idx);
-			const auto& y = op != codeGen.isa.opCodeForName("set") ? 
-				SelectOperand(codeGen, chainR, codeGen.regY[idx], idx) :
-				codeGen.ctx.bv_val(0, 32);
+void AddInstructionConstraints(CodeGenContext& codeGen, const int idx)
+{
+	codeGen.solver.add(codeGen.opCode[idx].rangeConstraint());
+	codeGen.solver.add(codeGen.regX[idx].rangeConstraint());
+	codeGen.solver.add(codeGen.regY[idx].rangeConstraint());
 
-			const auto& imm = codeGen.imm32[idx];
-			auto opers = SimOperands(codeGen.ctx, x, y, imm);
+	z3::expr_vector shiftConstraints(codeGen.ctx);
+	shiftConstraints.push_back(codeGen.imm32[idx] > 0);
+	shiftConstraints.push_back(codeGen.imm32[idx] <= codeGen.bitWidth - 1);
+	z3::expr andShiftConstriants = z3::mk_and(shiftConstraints);
 
-			z3::expr cond = codeGen.ctx.bv_val(0, 32);
-			for (int opcodeIdx = codeGen.isa.size() - 1; opcodeIdx >= 0; opcodeIdx--)
-			{
-				cond = z3::to_expr(codeGen.ctx, z3::ite(op == opcodeIdx, codeGen.isa.simulateOp(opcodeIdx, opers), cond));
-			}
+	for (const int shiftOpCode: codeGen.isa.opCodesForKindMask(Instruction::Kind_Shift))
+	{
+		codeGen.solver.add(z3::to_expr(codeGen.ctx, z3::implies(codeGen.opCode[idx].eq(shiftOpCode), andShiftConstriants)));
+	}
 
-			codeGen.solver.add(chainR[idx] == cond);
-		}
+	AddSketchConstraints(codeGen, idx);
+
+	if (codeGen.symmetryBreaking)
+	{
+		AddSymmetryConstraints(codeGen, idx);
 	}
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-EvalOperands CreateEvalOperands(CodeGenContext& codeGen, const int instructionIdx, int& opcodeIdx)
+void AddConstraints(CodeGenContext& codeGen)
 {
-	const auto model = codeGen.solver.get_model();
-	const auto op    = model.eval(codeGen.opCode[instructionIdx]).get_numeral_int();
-	const auto x     = model.eval(codeGen.regX[instructionIdx]).get_numeral_int();
-	const auto y     = model.eval(codeGen.regY[instructionIdx]).get_numeral_int();
+	ScopedTimer timer(codeGen.phases.addConstraintsUs);
 
-	// imm32 is not always retreivable so need to check first
-	const auto imm_  = model.eval(codeGen.imm32[instructionIdx]);
-	const auto imm   = imm_.is_numeral() ? imm_.get_numeral_uint() : 0;
+	for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
+	{
+		AddInstructionConstraints(codeGen, idx);
+	}
 
-	opcodeIdx = op;
-	return EvalOperands(codeGen.ctx, x, y, imm);
+	if (codeGen.symmetryBreaking)
+	{
+		AddDeadCodeConstraints(codeGen);
+	}
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-void PrintModel(CodeGenContext& codeGen, int numInputs)
+z3::expr SelectOperand(CodeGenContext& codeGen, z3::expr_vector& R, const IndexVar& regIdx, const int instructionIdx)
 {
-	printf("Generated code:\n");
+	z3::expr cond = codeGen.ctx.bv_val(0, codeGen.bitWidth);
+	for (int i = instructionIdx - 1; i >= 0; i--)
+	{
+		cond = z3::to_expr(codeGen.ctx, z3::ite(regIdx.eq(i), R[i], cond));
+	}
 
-	for (int i = 0; i < numInputs; i++)
+	return cond;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+z3::expr CreateChainConstant(CodeGenContext& codeGen, const int c, const int idx)
+{
+	char name[16];
+	sprintf(name, "R%d_c%d", idx, c);
+	return codeGen.ctx.bv_const(name, codeGen.bitWidth);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The result of executing instruction idx given the values of the previous registers, the opcode and operand
+// variables select which value of each it is. The parts the sketch fixes are used directly rather than selected.
+z3::expr SimulateInstruction(CodeGenContext& codeGen, z3::expr_vector& chainR, const int idx)
+{
+	const SketchSlot* slot = SketchSlotFor(codeGen, idx);
+	const int fixedX = slot ? slot->regX : -1;
+	const int fixedY = slot ? slot->regY : -1;
+
+	const auto& op = codeGen.opCode[idx];
+	const auto& x = fixedX >= 0 ? chainR[fixedX] : SelectOperand(codeGen, chainR, codeGen.regX[idx], idx);
+	const auto& y = fixedY >= 0 ? chainR[fixedY] : SelectOperand(codeGen, chainR, codeGen.regY[idx], idx);
+
+	const auto& imm = codeGen.imm32[idx];
+	auto opers = SimOperands(codeGen.ctx, x, y, imm);
+
+	const std::vector<int> opcodes = AllowedOpCodes(codeGen, idx);
+	if (opcodes.size() == 1)
 	{
-		printf("  r%d = <input>\n", i);
+		return codeGen.isa.simulateOp(opcodes[0], opers);
 	}
 
-	for (int instrIdx = numInputs; instrIdx < codeGen.numInstr; instrIdx++)
+	z3::expr cond = codeGen.ctx.bv_val(0, codeGen.bitWidth);
+	for (auto it = opcodes.rbegin(); it != opcodes.rend(); ++it)
 	{
-		int opcodeIdx = -1;
-		const auto opers = CreateEvalOperands(codeGen, instrIdx, opcodeIdx);
-		codeGen.isa.formatOp(opcodeIdx, instrIdx, opers);
+		cond = z3::to_expr(codeGen.ctx, z3::ite(op.eq(*it), codeGen.isa.simulateOp(*it, opers), cond));
 	}
 
-	printf("\n");
+	return cond;
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-std::vector<ValueType> Evaluate(CodeGenContext& codeGen, const std::vector<ValueType>& initValues)
+// Constrain R[c][idx] to be the result of executing instruction idx on chain c with location variables: the operands
+// are chain constants equal to the register their index selects and the result equals the selected op's result. An
+// operand the sketch fixes is the register itself.
+void AddLocationInstruction(CodeGenContext& codeGen, const int c, const int idx)
 {
-	std::vector<ValueType> evalState(codeGen.numInstr);
-	for (int i = 0; i < initValues.size(); i++)
+	auto& chainR = codeGen.R[c];
+	const SketchSlot* slot = SketchSlotFor(codeGen, idx);
+	const int fixedX = slot ? slot->regX : -1;
+	const int fixedY = slot ? slot->regY : -1;
+
+	char name[32];
+	sprintf(name, "X%d_c%d", idx, c);
+	const z3::expr x = fixedX >= 0 ? chainR[fixedX] : codeGen.ctx.bv_const(name, codeGen.bitWidth);
+	sprintf(name, "Y%d_c%d", idx, c);
+	const z3::expr y = fixedY >= 0 ? chainR[fixedY] : codeGen.ctx.bv_const(name, codeGen.bitWidth);
+
+	for (int i = 0; i < idx; i++)
 	{
-		evalState[i] = initValues[i];
+		if (fixedX < 0)
+		{
+			codeGen.solver.add(z3::implies(codeGen.regX[idx].eq(i), x == chainR[i]));
+		}
+
+		if (fixedY < 0)
+		{
+			codeGen.solver.add(z3::implies(codeGen.regY[idx].eq(i), y == chainR[i]));
+		}
 	}
 
-	for (int instrIdx = codeGen.numInputs; instrIdx < codeGen.numInstr; instrIdx++)
+	auto opers = SimOperands(codeGen.ctx, x, y, codeGen.imm32[idx]);
+	for (const int opcodeIdx: AllowedOpCodes(codeGen, idx))
 	{
-		int opcodeIdx = -1;
-		auto opers = CreateEvalOperands(codeGen, instrIdx, opcodeIdx);
+		codeGen.solver.add(z3::implies(codeGen.opCode[idx].eq(opcodeIdx), chainR[idx] == codeGen.isa.simulateOp(opcodeIdx, opers)));
+	}
+}
 
-		// if we're evaluation we want x & y to have the values of the registers
-		opers.x = evalState[opers.x];
-		opers.y = evalState[opers.y];
+// ====================================================================================================================
+// ====================================================================================================================
 
-		evalState[instrIdx] = codeGen.isa.evaluateOp(opcodeIdx, opers);
+// Constrain R[c][idx] to be the result of executing instruction idx on chain c
+void AddChainInstruction(CodeGenContext& codeGen, const int c, const int idx)
+{
+	if (codeGen.chainEncoding == ChainEncoding::Location)
+	{
+		AddLocationInstruction(codeGen, c, idx);
+		return;
 	}
 
-	return evalState;
+	auto& chainR = codeGen.R[c];
+	codeGen.solver.add(chainR[idx] == SimulateInstruction(codeGen, chainR, idx));
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-z3::check_result Solve(CodeGenContext& codeGen)
+void AddChainOutput(CodeGenContext& codeGen, const int c)
 {
-	const auto start = std::chrono::high_resolution_clock::now();
-	const auto res = codeGen.solver.check();
-	const auto end = std::chrono::high_resolution_clock::now();
-	const auto delta = end - start;
-	const auto delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(delta);
-	printf("  solver.check() call completed: %d ms\n", delta_ms);
+	const ValueType out = NarrowValue(codeGen.bitWidth, codeGen.target(codeGen.chainInputs[c]));
+	const auto& chainR = codeGen.R[c];
 
-	return res;
+	codeGen.solver.add(z3::implies(codeGen.outputGuard, chainR[codeGen.numInstr - 1] == codeGen.ctx.bv_val(out, codeGen.bitWidth)));
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-static bool EvaluateModel(CodeGenContext& codeGen)
+// Add a new chain to the solver which constrains the program to produce TargetFunc(input) for the input value
+void AddChain(CodeGenContext& codeGen, const ValueType input)
 {
-	int numPassed = 0;
-	const ValueType x = rndDist(prng);
-	const ValueType y = rndDist(prng);
-	const ValueType expected = TargetFunc(x);
+	ScopedTimer timer(codeGen.phases.addChainsUs);
+
+	const int c = codeGen.numChains++;
+
+	z3::expr_vector chainR(codeGen.ctx);
+	for (int idx = 0; idx < codeGen.numInstr; idx++)
+	{
+		chainR.push_back(CreateChainConstant(codeGen, c, idx));
+	}
 
-	const auto stateValues = Evaluate(codeGen, {x, y});
-	const ValueType actual = stateValues.back();
-	return  expected == actual;
+	codeGen.R.push_back(chainR);
+	codeGen.chainInputs.push_back(input);
+
+	codeGen.solver.add(chainR[0] == codeGen.ctx.bv_val(input, codeGen.bitWidth));
+	for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
+	{
+		AddChainInstruction(codeGen, c, idx);
+	}
+
+	AddChainOutput(codeGen, c);
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-bool FindSolution(const int numInstructions, const ISASubset& isa)
+// Extend the program by one instruction: the existing instructions, chains and any clauses the solver has learned
+// about them are kept and only the constraints for the new instruction are added. The outputs of the previous 
+// length are disabled by retiring its guard and a new guard literal is used for the new length.
+void AddInstruction(CodeGenContext& codeGen)
 {
-	z3::context ctx;
+	ScopedTimer timer(codeGen.phases.addConstraintsUs);
 
-	const int numChains = 10;
-	const int numInputs = 1;
+	const int idx = codeGen.numInstr++;
 
-	CodeGenContext codeGen(ctx, numInputs, numChains, numInstructions, isa);
+	CreateInstructionConstants(codeGen, idx);
+	AddInstructionConstraints(codeGen, idx);
 
-	CreateConstants(codeGen);
-	AddConstraints(codeGen);
-	AddPerChainConstraints(codeGen);
+	for (int c = 0; c < codeGen.numChains; c++)
+	{
+		codeGen.R[c].push_back(CreateChainConstant(codeGen, c, idx));
+		AddChainInstruction(codeGen, c, idx);
+	}
 
-	const auto res = Solve(codeGen);
-	if (res != z3::sat)
+	if (!codeGen.outputGuard.is_true())
 	{
-		printf("  unsatifiable\n");
-		return false;
+		codeGen.solver.add(!codeGen.outputGuard);
 	}
 
-	printf("  satisified!\n\n");
+	char name[16];
+	sprintf(name, "length_%d", codeGen.numInstr);
+	codeGen.outputGuard = codeGen.ctx.bool_const(name);
+
+	for (int c = 0; c < codeGen.numChains; c++)
+	{
+		AddChainOutput(codeGen, c);
+	}
 
-	PrintModel(codeGen, numInputs);
+	if (codeGen.symmetryBreaking)
+	{
+		AddDeadCodeConstraints(codeGen);
+	}
+}
 
-	const int NUM_TESTS = 10000;
-	int numPassed = 0;
-	printf("Testing with random values...\n");
-	for (int i = 0; i < NUM_TESTS; i++)
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A random input for the target, only inputs in the domain are used if the target has one
+ValueType RandomInput(CodeGenContext& codeGen)
+{
+	if (!codeGen.inputDomain.empty())
+	{
+		std::uniform_int_distribution<int> idxDist(0, static_cast<int>(codeGen.inputDomain.size()) - 1);
+		return NarrowValue(codeGen.bitWidth, codeGen.inputDomain[idxDist(codeGen.prng)]);
+	}
+
+	return NarrowValue(codeGen.bitWidth, codeGen.rndDist(codeGen.prng));
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Targets with a domain (I/O tables) are small so rather than sampling every input gets a chain
+void AddPerChainConstraints(CodeGenContext& codeGen, const int numChains)
+{
+	if (!codeGen.inputDomain.empty())
 	{
-		if (!EvaluateModel(codeGen))
+		for (const ValueType input: codeGen.inputDomain)
 		{
-			break;
+			AddChain(codeGen, NarrowValue(codeGen.bitWidth, input));
 		}
 
-		numPassed++;
+		return;
 	}
-	printf("  %d / %d passed\n\n", numPassed, NUM_TESTS);
 
-	return true;
+	for (int c = 0; c < numChains; c++)
+	{
+		const int j = c - 1;
+		AddChain(codeGen, j >= 0 && j < static_cast<int>(codeGen.interestingInputs.size()) ? codeGen.interestingInputs[j] : RandomInput(codeGen));
+	}
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-int main(int argc, char** argv)
+// Decode the model into a Program once so it can be evaluated without going back to the solver
+Program DecodeProgram(CodeGenContext& codeGen)
 {
-	// Don't need to always use the full ISA
-	ISASubset isa;
-	isa.addOpcode(ISA_OpCodeForName("set"));
-//	isa.addOpcode(ISA_OpCodeForName("add"));
-	isa.addOpcode(ISA_OpCodeForName("sub"));
-	isa.addOpcode(ISA_OpCodeForName("xor"));
-//	isa.addOpcode(ISA_OpCodeForName("shr"));
-	isa.addOpcode(ISA_OpCodeForName("gt"));
+	ScopedTimer timer(codeGen.phases.decodeUs);
+
+	const auto model = codeGen.solver.get_model();
+
+	Program program;
+	program.numInputs = codeGen.numInputs;
+	program.bitWidth = codeGen.bitWidth;
+	program.resize(codeGen.numInstr);
 
-	const int minInstructions = 2;
-	const int maxInstructions = 8;
-	for (int i = 2; i < maxInstructions; i++)
+	for (int instrIdx = codeGen.numInputs; instrIdx < codeGen.numInstr; instrIdx++)
 	{
-		try
-		{
-			printf("Try with %d instructions...\n", i);
-			if (FindSolution(i, isa))
+		program.opcode[instrIdx] = codeGen.isa.isaOpCode(codeGen.opCode[instrIdx].decode(model));
+		program.regX[instrIdx] = codeGen.regX[instrIdx].decode(model);
+		program.regY[instrIdx] = codeGen.regY[instrIdx].decode(model);
+
+		// imm32 is not always retreivable so need to check first
+		const auto imm = model.eval(codeGen.imm32[instrIdx]);
+		program.imm[instrIdx] = NarrowValue(codeGen.bitWidth, imm.is_numeral() ? imm.get_numeral_uint() : 0);
+	}
+
+	return program;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+z3::check_result Solve(CodeGenContext& codeGen)
+{
+	z3::expr_vector assumptions(codeGen.ctx);
+	if (!codeGen.outputGuard.is_true())
+	{
+		assumptions.push_back(codeGen.outputGuard);
+	}
+
+	// the timeout parameter stops the check cleanly, the watchdog is the backstop
+	if (codeGen.deadline != Watchdog::Clock::time_point::max())
+	{
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(codeGen.deadline - Watchdog::Clock::now());
+		if (remaining.count() <= 0)
+		{
+			return z3::unknown;
+		}
+
+		z3::params params(codeGen.ctx);
+		params.set("timeout", static_cast<unsigned>(std::min<long long>(remaining.count(), UINT_MAX)));
+		codeGen.solver.set(params);
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	const auto res = codeGen.solver.check(assumptions);
+	const auto end = std::chrono::high_resolution_clock::now();
+	const auto delta = end - start;
+	const auto delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(delta);
+	codeGen.solveTimeMs += delta_ms.count();
+	codeGen.phases.checkUs += std::chrono::duration_cast<std::chrono::microseconds>(delta).count();
+	codeGen.phases.numChecks++;
+	if (codeGen.verbose)
+	{
+		printf("  solver.check() call completed: %lld ms\n", static_cast<long long>(delta_ms.count()));
+	}
+
+	return res;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Why a check returned unknown: the time budget ran out, the memory limit was reached or the solver gave up
+std::string UnknownReason(CodeGenContext& codeGen)
+{
+	if (Watchdog::Clock::now() >= codeGen.deadline)
+	{
+		return "out of time";
+	}
+
+	return codeGen.solver.reason_unknown();
+}
+
+// Prints the result of a length which wasn't satisfied
+void PrintNotSatisfied(CodeGenContext& codeGen, const z3::check_result res)
+{
+	if (res == z3::unknown)
+	{
+		printf("  unknown (%s, %d chains)\n", UnknownReason(codeGen).c_str(), codeGen.numChains);
+	}
+	else
+	{
+		printf("  unsatifiable (%d chains)\n", codeGen.numChains);
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Run the program against random inputs, returns the number of tests which passed before the first failure
+// and stores the failing input in counterExample
+static int TestProgram(CodeGenContext& codeGen, const Program& program, const int numTests, ValueType& counterExample)
+{
+	ScopedTimer timer(codeGen.phases.verifyUs);
+
+	std::vector<ValueType> inputs(numTests);
+	std::vector<ValueType> outputs(numTests);
+	const int numInteresting = std::min(numTests, static_cast<int>(codeGen.interestingInputs.size()));
+	for (int i = 0; i < numTests; i++)
+	{
+		const int j = i - (numTests - numInteresting);
+		inputs[i] = j >= 0 ? codeGen.interestingInputs[j] : RandomInput(codeGen);
+	}
+
+	program.evaluateBatch(inputs.data(), outputs.data(), numTests);
+
+	for (int i = 0; i < numTests; i++)
+	{
+		if (outputs[i] != NarrowValue(program.bitWidth, codeGen.target(inputs[i])))
+		{
+			counterExample = inputs[i];
+			return i;
+		}
+	}
+
+	return numTests;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+const int SPLIT_RANDOM_INPUTS = 512;
+const int MAX_REJECTED = 64;
+
+// Choose the counterexample for a candidate which failed the tests from the inputs it gets wrong: the one which the 
+// most of the previously rejected candidates also get wrong, as an input which splits those candidates from the 
+// target is likely to rule out the candidates the solver would try next as well
+static ValueType SplittingCounterExample(CodeGenContext& codeGen, const Program& candidate, const ValueType counterExample)
+{
+	ScopedTimer timer(codeGen.phases.verifyUs);
+
+	std::vector<ValueType> inputs = codeGen.interestingInputs;
+	for (int i = 0; i < SPLIT_RANDOM_INPUTS; i++)
+	{
+		inputs.push_back(RandomInput(codeGen));
+	}
+
+	inputs.push_back(counterExample);
+
+	const int numInputs = static_cast<int>(inputs.size());
+	std::vector<ValueType> expected(numInputs);
+	for (int i = 0; i < numInputs; i++)
+	{
+		expected[i] = NarrowValue(candidate.bitWidth, codeGen.target(inputs[i]));
+	}
+
+	std::vector<ValueType> outputs(numInputs);
+	candidate.evaluateBatch(inputs.data(), outputs.data(), numInputs);
+
+	std::vector<int> failing;
+	for (int i = 0; i < numInputs; i++)
+	{
+		if (outputs[i] != expected[i])
+		{
+			failing.push_back(i);
+		}
+	}
+
+	std::vector<int> score(numInputs, 0);
+	for (const Program& program: codeGen.rejected)
+	{
+		program.evaluateBatch(inputs.data(), outputs.data(), numInputs);
+		for (const int i: failing)
+		{
+			score[i] += outputs[i] != expected[i] ? 1 : 0;
+		}
+	}
+
+	// the earliest input wins a tie so the interesting inputs are preferred over the random ones
+	int best = failing.back();
+	for (const int i: failing)
+	{
+		if (score[i] > score[best] || (score[i] == score[best] && i < best))
+		{
+			best = i;
+		}
+	}
+
+	if (static_cast<int>(codeGen.rejected.size()) < MAX_REJECTED)
+	{
+		codeGen.rejected.push_back(candidate);
+	}
+
+	return inputs[best];
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+const int MAX_COUNTEREXAMPLES = 8;
+
+// Run the program on all 2^32 inputs. The input range is split into chunks which are run on the thread pool and each
+// chunk is evaluated a block at a time with the batch kernels. Stops once MAX_COUNTEREXAMPLES failing inputs have 
+// been found and stores them in counterExamples, returns true if every input passed.
+bool SweepAllInputs(const Program& program, const TargetFn& target, const int numThreads, std::vector<ValueType>& counterExamples)
+{
+	const int CHUNK_BITS = 20;
+	const int numChunks = 1 << (32 - CHUNK_BITS);
+
+	std::mutex mutex;
+	std::vector<uint32_t> failing;
+	std::atomic<bool> stop(false);
+
+	{
+		ThreadPool pool(numThreads);
+		for (int chunk = 0; chunk < numChunks; chunk++)
+		{
+			pool.submit([&, chunk]()
+			{
+				if (stop)
+				{
+					return;
+				}
+
+				ValueType inputs[Program::BATCH_SIZE];
+				ValueType outputs[Program::BATCH_SIZE];
+
+				const uint32_t chunkStart = static_cast<uint32_t>(chunk) << CHUNK_BITS;
+				for (uint32_t base = 0; base < (1u << CHUNK_BITS); base += Program::BATCH_SIZE)
+				{
+					for (int j = 0; j < Program::BATCH_SIZE; j++)
+					{
+						inputs[j] = static_cast<ValueType>(chunkStart + base + j);
+					}
+
+					program.evaluateBatch(inputs, outputs, Program::BATCH_SIZE);
+
+					for (int j = 0; j < Program::BATCH_SIZE; j++)
+					{
+						if (outputs[j] != target(inputs[j]))
+						{
+							std::lock_guard<std::mutex> lock(mutex);
+							failing.push_back(static_cast<uint32_t>(inputs[j]));
+							stop = failing.size() >= MAX_COUNTEREXAMPLES;
+						}
+					}
+
+					if (stop)
+					{
+						return;
+					}
+				}
+			});
+		}
+
+		pool.wait();
+	}
+
+	std::sort(failing.begin(), failing.end());
+	failing.resize(std::min(static_cast<int>(failing.size()), MAX_COUNTEREXAMPLES));
+
+	counterExamples.clear();
+	for (const uint32_t x: failing)
+	{
+		counterExamples.push_back(static_cast<ValueType>(x));
+	}
+
+	return counterExamples.empty();
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Run SweepAllInputs on a program which didn't come from SolveVerified and print the result and the counterexamples,
+// which are also stored in counterExamples if it isn't null
+bool VerifyExhaustive(const Program& program, const SynthOptions& options, std::vector<ValueType>* counterExamples = nullptr)
+{
+	printf("Testing all 2^32 values...\n");
+	if (program.numInputs != 1 || program.bitWidth != 32)
+	{
+		printf("  only supported for 32 bit programs with a single input\n\n");
+		return false;
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<ValueType> failing;
+	const bool passed = SweepAllInputs(program, options.target, options.numThreads, failing);
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	const auto delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+	if (counterExamples)
+	{
+		*counterExamples = failing;
+	}
+
+	if (passed)
+	{
+		printf("  all passed: %lld ms\n\n", static_cast<long long>(delta_ms.count()));
+		return true;
+	}
+
+	printf("  failed: %lld ms\n", static_cast<long long>(delta_ms.count()));
+	for (const ValueType input: failing)
+	{
+		printf("  counterexample x=0x%08x: expected 0x%08x, got 0x%08x\n", input, options.target(input), program.evaluate(&input));
+	}
+
+	printf("\n");
+	return false;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Prove the program matches options.simTarget for every input (or every input in the domain) by asking the solver 
+// for an input where they differ, the program is equivalent when there is none. The input found is stored in 
+// counterExamples if it isn't null.
+bool VerifyEquivalent(const Program& program, const SynthOptions& options, std::vector<ValueType>* counterExamples = nullptr)
+{
+	printf("Proving equivalence with the solver...\n");
+	if (program.numInputs != 1 || program.bitWidth != 32)
+	{
+		printf("  only supported for 32 bit programs with a single input\n\n");
+		return false;
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	z3::context ctx;
+	const z3::expr input = ctx.bv_const("x", 32);
+
+	z3::expr_vector R(ctx);
+	R.push_back(input);
+	for (int i = program.numInputs; i < program.size(); i++)
+	{
+		SimOperands opers(ctx, R[program.regX[i]], R[program.regY[i]], ctx.bv_val(program.imm[i], 32));
+		R.push_back(ISA_SimulateOp(program.opcode[i], opers));
+	}
+
+	z3::solver solver(ctx, "QF_BV");
+	solver.add(R[program.size() - 1] != options.simTarget(input));
+	if (!options.inputDomain.empty())
+	{
+		z3::expr_vector inDomain(ctx);
+		for (const ValueType v: options.inputDomain)
+		{
+			inDomain.push_back(input == ctx.bv_val(v, 32));
+		}
+
+		solver.add(z3::mk_or(inDomain));
+	}
+
+	const z3::check_result res = solver.check();
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	const auto delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+	if (res == z3::unsat)
+	{
+		printf("  equivalent: %lld ms\n\n", static_cast<long long>(delta_ms.count()));
+		return true;
+	}
+
+	if (res == z3::unknown)
+	{
+		printf("  unknown (%s): %lld ms\n\n", solver.reason_unknown().c_str(), static_cast<long long>(delta_ms.count()));
+		return false;
+	}
+
+	const uint32_t x = solver.get_model().eval(input, true).get_numeral_uint();
+	const ValueType counterExample = static_cast<ValueType>(x);
+	if (counterExamples)
+	{
+		counterExamples->assign(1, counterExample);
+	}
+
+	printf("  failed: %lld ms\n", static_cast<long long>(delta_ms.count()));
+	printf("  counterexample x=0x%08x: expected 0x%08x, got 0x%08x\n\n", x, options.target(counterExample), program.evaluate(&counterExample));
+	return false;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The number of distinct AST nodes in the solver's assertions, shared sub-expressions are only counted once
+static long long CountASTNodes(const z3::expr_vector& assertions)
+{
+	std::vector<z3::expr> stack;
+	for (unsigned i = 0; i < assertions.size(); i++)
+	{
+		stack.push_back(assertions[i]);
+	}
+
+	std::unordered_set<unsigned> visited;
+	while (!stack.empty())
+	{
+		const z3::expr e = stack.back();
+		stack.pop_back();
+
+		if (!visited.insert(e.id()).second || !e.is_app())
+		{
+			continue;
+		}
+
+		for (unsigned i = 0; i < e.num_args(); i++)
+		{
+			stack.push_back(e.arg(i));
+		}
+	}
+
+	return static_cast<long long>(visited.size());
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Add the phase times, formula size and the solver's statistics for the context's current length to the stats log
+void RecordLengthStats(CodeGenContext& codeGen, const SynthOptions& options, const z3::check_result res)
+{
+	if (!options.statsLog)
+	{
+		return;
+	}
+
+	const PhaseTimes& phases = codeGen.phases;
+	const z3::expr_vector assertions = codeGen.solver.assertions();
+	const char* result = res == z3::sat ? "sat" : res == z3::unsat ? "unsat" : "unknown";
+
+	char buffer[512];
+	sprintf(buffer, "{ \"length\": %d, \"bit_width\": %d, \"result\": \"%s\", \"chains\": %d, \"checks\": %d, "
+		"\"phases_ms\": { \"create_constants\": %.3f, \"add_constraints\": %.3f, \"add_chains\": %.3f, \"check\": %.3f, "
+		"\"decode\": %.3f, \"verify\": %.3f }, \"assertions\": %u, \"ast_nodes\": %lld, ",
+		codeGen.numInstr, codeGen.bitWidth, result, codeGen.numChains, phases.numChecks,
+		phases.createConstantsUs / 1000.0, phases.addConstraintsUs / 1000.0, phases.addChainsUs / 1000.0, phases.checkUs / 1000.0,
+		phases.decodeUs / 1000.0, phases.verifyUs / 1000.0, assertions.size(), CountASTNodes(assertions));
+
+	std::string json = buffer;
+	json += "\"z3\": { ";
+
+	const z3::stats stats = codeGen.solver.statistics();
+	for (unsigned i = 0; i < stats.size(); i++)
+	{
+		if (stats.is_uint(i))
+		{
+			sprintf(buffer, "%u", stats.uint_value(i));
+		}
+		else
+		{
+			sprintf(buffer, "%g", stats.double_value(i));
+		}
+
+		json += (i > 0 ? ", " : "") + JsonString(stats.key(i)) + ": " + buffer;
+	}
+
+	json += " } }";
+	options.statsLog->addLength(json);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Check the solver and each time the model fails verification add the failing inputs as new chains and re-check. The
+// model is tested with random values and then with --exhaustive on all 2^32 inputs, so sat is only returned for a 
+// program which passed both. Targets with a domain have a chain for every input already so aren't swept.
+z3::check_result SolveVerified(CodeGenContext& codeGen)
+{
+	while (true)
+	{
+		const auto res = Solve(codeGen);
+		if (res != z3::sat)
+		{
+			return res;
+		}
+
+		ValueType counterExample = 0;
+		const Program candidate = DecodeProgram(codeGen);
+		const int numPassed = TestProgram(codeGen, candidate, NUM_TESTS, counterExample);
+		if (numPassed < NUM_TESTS)
+		{
+			if (codeGen.adaptiveInputs)
+			{
+				counterExample = SplittingCounterExample(codeGen, candidate, counterExample);
+			}
+
+			if (codeGen.verbose)
+			{
+				printf("  counterexample x=0x%x, adding chain %d\n", counterExample, codeGen.numChains);
+			}
+
+			AddChain(codeGen, counterExample);
+			continue;
+		}
+
+		if (!codeGen.exhaustive || codeGen.bitWidth != 32 || !codeGen.inputDomain.empty())
+		{
+			return res;
+		}
+
+		std::vector<ValueType> counterExamples;
+		{
+			ScopedTimer timer(codeGen.phases.verifyUs);
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			const bool passed = SweepAllInputs(candidate, codeGen.target, codeGen.numThreads, counterExamples);
+			const auto delta = std::chrono::high_resolution_clock::now() - start;
+			codeGen.exhaustiveMs = std::chrono::duration_cast<std::chrono::milliseconds>(delta).count();
+			if (passed)
+			{
+				return res;
+			}
+		}
+
+		if (codeGen.verbose)
+		{
+			printf("  failed the exhaustive test, adding %d chains\n", static_cast<int>(counterExamples.size()));
+		}
+
+		for (const ValueType input: counterExamples)
+		{
+			AddChain(codeGen, input);
+		}
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Build the encoding for the context's length, starting with numChains chains, and solve it with SolveVerified
+z3::check_result SolveLength(CodeGenContext& codeGen, const int numChains)
+{
+	CreateConstants(codeGen);
+	AddConstraints(codeGen);
+	AddPerChainConstraints(codeGen, numChains);
+
+	return SolveVerified(codeGen);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Print a program which SolveVerified accepted and the tests it passed, exhaustiveMs is -1 if it wasn't swept
+void PrintSolution(const Program& program, const long long exhaustiveMs)
+{
+	program.print();
+
+	printf("Testing with random values...\n");
+	printf("  %d / %d passed\n\n", NUM_TESTS, NUM_TESTS);
+
+	if (exhaustiveMs >= 0)
+	{
+		printf("Testing all 2^32 values...\n");
+		printf("  all passed: %lld ms\n\n", exhaustiveMs);
+	}
+}
+
+void PrintSolution(CodeGenContext& codeGen)
+{
+	PrintSolution(DecodeProgram(codeGen), codeGen.exhaustiveMs);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A cached program was verified when it was stored, but the key is only a fingerprint of the target's outputs so the
+// target may have changed since. It is tested again the same way as a model before it is reported.
+bool VerifyCachedProgram(const Program& program, const ISASubset& isa, const SynthOptions& options)
+{
+	z3::context ctx;
+	CodeGenContext codeGen(ctx, program.numInputs, program.size(), isa, options);
+
+	ValueType counterExample = 0;
+	printf("Testing with random values...\n");
+	const int numPassed = TestProgram(codeGen, program, NUM_TESTS, counterExample);
+	printf("  %d / %d passed\n", numPassed, NUM_TESTS);
+	if (numPassed < NUM_TESTS)
+	{
+		printf("  counterexample x=0x%08x: expected 0x%08x, got 0x%08x\n\n", counterExample, options.target(counterExample), program.evaluate(&counterExample));
+		return false;
+	}
+
+	printf("\n");
+	return !options.exhaustive || VerifyExhaustive(program, options);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Solve the length with a fixed number of chains to start with, the chains for the counterexamples are only added
+// if the model fails the tests
+z3::check_result FindSolution(const int numInstructions, const ISASubset& isa, const SynthOptions& options, Program* foundProgram = nullptr)
+{
+	z3::context ctx;
+
+	const int numChains = 10;
+	const int numInputs = 1;
+
+	CodeGenContext codeGen(ctx, numInputs, numInstructions, isa, options);
+
+	const auto res = SolveLength(codeGen, numChains);
+	RecordLengthStats(codeGen, options, res);
+	if (res != z3::sat)
+	{
+		PrintNotSatisfied(codeGen, res);
+		return res;
+	}
+
+	printf("  satisified! (%d chains)\n\n", codeGen.numChains);
+
+	PrintSolution(codeGen);
+
+	if (foundProgram)
+	{
+		*foundProgram = DecodeProgram(codeGen);
+	}
+
+	return z3::sat;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+const int COST_BITS = 16;
+
+// The cost of an opcode for the objective, throughput costs are in hundredths of a cycle so they are integers 
+int OpCost(const CostObjective objective, const int opcode)
+{
+	if (objective == CostObjective::Latency)
+	{
+		return ISA_OpLatency(opcode);
+	}
+
+	return static_cast<int>(ISA_OpThroughput(opcode) * 100.f + 0.5f);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+int ProgramCost(const CostObjective objective, const Program& program)
+{
+	if (objective == CostObjective::Latency)
+	{
+		return program.latency();
+	}
+
+	int cost = 0;
+	for (int i = program.numInputs; i < program.size(); i++)
+	{
+		cost += OpCost(objective, program.opcode[i]);
+	}
+
+	return cost;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void PrintCost(const CostObjective objective, const int cost)
+{
+	if (objective == CostObjective::Latency)
+	{
+		printf("%d cycles latency", cost);
+	}
+	else
+	{
+		printf("%.2f cycles throughput", cost / 100.f);
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The cost of the program as a solver expression which matches ProgramCost. For the latency each register has a 
+// depth: the inputs are 0 and each instruction is its latency plus the deepest register operand it reads.
+z3::expr CreateCostExpr(CodeGenContext& codeGen, const CostObjective objective)
+{
+	z3::context& ctx = codeGen.ctx;
+	const z3::expr zero = ctx.bv_val(0, COST_BITS);
+
+	auto opCost = [&](const int idx)
+	{
+		z3::expr cost = zero;
+		for (int opcodeIdx = codeGen.isa.size() - 1; opcodeIdx >= 0; opcodeIdx--)
+		{
+			const int c = OpCost(objective, codeGen.isa.isaOpCode(opcodeIdx));
+			cost = z3::ite(codeGen.opCode[idx].eq(opcodeIdx), ctx.bv_val(c, COST_BITS), cost);
+		}
+
+		return cost;
+	};
+
+	if (objective != CostObjective::Latency)
+	{
+		z3::expr total = zero;
+		for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
+		{
+			total = total + opCost(idx);
+		}
+
+		return total;
+	}
+
+	auto readsOperand = [&](const int idx, const int minArity)
+	{
+		z3::expr_vector ops(ctx);
+		for (int opcodeIdx = 0; opcodeIdx < codeGen.isa.size(); opcodeIdx++)
+		{
+			if (codeGen.isa.opArity(opcodeIdx) >= minArity)
+			{
+				ops.push_back(codeGen.opCode[idx].eq(opcodeIdx));
+			}
+		}
+
+		return z3::mk_or(ops);
+	};
+
+	std::vector<z3::expr> depth(codeGen.numInputs, zero);
+	for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
+	{
+		z3::expr dx = zero;
+		z3::expr dy = zero;
+		for (int i = idx - 1; i >= 0; i--)
+		{
+			dx = z3::ite(codeGen.regX[idx].eq(i), depth[i], dx);
+			dy = z3::ite(codeGen.regY[idx].eq(i), depth[i], dy);
+		}
+
+		const z3::expr ready = z3::ite(readsOperand(idx, 1), z3::ite(readsOperand(idx, 2) && z3::ugt(dy, dx), dy, dx), zero);
+		depth.push_back(ready + opCost(idx));
+	}
+
+	return depth.back();
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Counterexample guided version of FindSolution: start with a small number of chains and each time the model 
+// fails verification add the failing input as a new chain and re-check with the same solver
+z3::check_result FindSolutionCEGIS(const int numInstructions, const ISASubset& isa, const SynthOptions& options, Program* foundProgram = nullptr)
+{
+	z3::context ctx;
+
+	const int numInitialChains = 2;
+	const int numInputs = 1;
+
+	CodeGenContext codeGen(ctx, numInputs, numInstructions, isa, options);
+
+	const auto res = SolveLength(codeGen, numInitialChains);
+	RecordLengthStats(codeGen, options, res);
+	if (res != z3::sat)
+	{
+		PrintNotSatisfied(codeGen, res);
+		return res;
+	}
+
+	printf("  satisified! (%d chains)\n\n", codeGen.numChains);
+
+	PrintSolution(codeGen);
+
+	if (foundProgram)
+	{
+		*foundProgram = DecodeProgram(codeGen);
+	}
+
+	return z3::sat;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Constrain the program to match the target for every input with a single symbolic chain under a quantifier, rather
+// than one chain per sampled input. The registers are expressions over the bound input rather than constants.
+void AddForallChain(CodeGenContext& codeGen, const SimTargetFn& simTarget)
+{
+	ScopedTimer timer(codeGen.phases.addChainsUs);
+
+	const z3::expr input = codeGen.ctx.bv_const("x", codeGen.bitWidth);
+
+	z3::expr_vector chainR(codeGen.ctx);
+	chainR.push_back(input);
+	for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
+	{
+		chainR.push_back(SimulateInstruction(codeGen, chainR, idx));
+	}
+
+	codeGen.solver.add(z3::forall(input, chainR[codeGen.numInstr - 1] == simTarget(input)));
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Solve "for all x: program(x) == target(x)" with Z3's quantified bit-vector solver. A model is a program which is
+// correct for every input so there are no tests, and unsat means no program of this length exists.
+z3::check_result FindSolutionForall(const int numInstructions, const ISASubset& isa, const SynthOptions& options, Program* foundProgram = nullptr)
+{
+	z3::context ctx;
+
+	const int numInputs = 1;
+
+	// the tactic pipelines only accept quantifier free formulas
+	SynthOptions forallOptions = options;
+	forallOptions.pipeline = SolverPipeline::Default;
+
+	CodeGenContext codeGen(ctx, numInputs, numInstructions, isa, forallOptions);
+
+	// E-matching finds no useful patterns in the bit-vector terms and keeps instantiating the quantifier until it runs
+	// out of memory, model based instantiation alone proves the short lengths unsatisfiable and finds the program
+	z3::params params(ctx);
+	params.set("ematching", false);
+	codeGen.solver.set(params);
+
+	CreateConstants(codeGen);
+	AddConstraints(codeGen);
+	AddForallChain(codeGen, options.simTarget);
+
+	// the model is still tested, a failure means the simulated ISA and the native one disagree and the failing inputs
+	// are added as chains like for the other searches
+	const auto res = SolveVerified(codeGen);
+	RecordLengthStats(codeGen, options, res);
+	if (res != z3::sat)
+	{
+		PrintNotSatisfied(codeGen, res);
+		return res;
+	}
+
+	printf("  satisified! (proved for all inputs)\n\n");
+
+	PrintSolution(codeGen);
+
+	if (foundProgram)
+	{
+		*foundProgram = DecodeProgram(codeGen);
+	}
+
+	return z3::sat;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Find the cheapest program with fewer than maxInstructions instructions rather than the shortest. Each length is 
+// solved with CEGIS and each time a program is found the cost is bounded to be less than the program's cost and the
+// solver is re-checked. The bound is carried over to the longer lengths so a longer program is only found if it is
+// cheaper than the best shorter one.
+bool FindSolutionCost(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options)
+{
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+	const CostObjective objective = options.costObjective;
+
+	int bestCost = INT_MAX;
+	Program best;
+	long long bestExhaustiveMs = -1;
+
+	// when a check runs out of time the best program so far is still reported, but it may not be the cheapest
+	bool isOptimal = true;
+
+	for (int numInstr = minInstructions; numInstr < maxInstructions; numInstr++)
+	{
+		printf("Try with %d instructions...\n", numInstr);
+
+		z3::context ctx;
+		CodeGenContext codeGen(ctx, numInputs, numInstr, isa, options);
+
+		CreateConstants(codeGen);
+		AddConstraints(codeGen);
+		AddPerChainConstraints(codeGen, numChains);
+
+		const z3::expr cost = CreateCostExpr(codeGen, objective);
+
+		int numFound = 0;
+		bool timedOut = false;
+		while (true)
+		{
+			if (bestCost != INT_MAX)
+			{
+				codeGen.solver.add(z3::ult(cost, ctx.bv_val(bestCost, COST_BITS)));
+			}
+
+			const auto res = SolveVerified(codeGen);
+			RecordLengthStats(codeGen, options, res);
+			codeGen.phases = PhaseTimes();
+			if (res == z3::unknown)
+			{
+				printf("  unknown (%s)\n", UnknownReason(codeGen).c_str());
+				timedOut = true;
+				isOptimal = false;
+			}
+
+			if (res != z3::sat)
+			{
+				break;
+			}
+
+			best = DecodeProgram(codeGen);
+			bestCost = ProgramCost(objective, best);
+			bestExhaustiveMs = codeGen.exhaustiveMs;
+			numFound++;
+
+			printf("  found ");
+			PrintCost(objective, bestCost);
+			printf("\n");
+		}
+
+		if (numFound == 0 && !timedOut)
+		{
+			printf(bestCost == INT_MAX ? "  unsatifiable\n" : "  nothing cheaper\n");
+		}
+	}
+
+	if (bestCost == INT_MAX)
+	{
+		return false;
+	}
+
+	printf("\n%s program: %d instructions, %d cycles latency, %.2f cycles throughput\n\n", 
+		isOptimal ? "Cheapest" : "Cheapest found within the time budget (not proven optimal)", 
+		best.size(), best.latency(), best.throughputCost());
+
+	PrintSolution(best, bestExhaustiveMs);
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Search all the lengths in [minInstructions, maxInstructions) with a single context and solver. Each length adds 
+// one instruction on top of the previous one so the chain constants and the solver's learned clauses are kept 
+// rather than rebuilding the whole problem for each length.
+bool FindSolutionIncremental(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options)
+{
+	z3::context ctx;
+
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+
+	CodeGenContext codeGen(ctx, numInputs, numInputs, isa, options);
+
+	CreateConstants(codeGen);
+	AddConstraints(codeGen);
+
+	while (codeGen.numInstr < minInstructions)
+	{
+		AddInstruction(codeGen);
+	}
+
+	AddPerChainConstraints(codeGen, numChains);
+
+	for (; codeGen.numInstr < maxInstructions; AddInstruction(codeGen))
+	{
+		printf("Try with %d instructions...\n", codeGen.numInstr);
+
+		codeGen.startLengthTimer();
+		const auto res = SolveVerified(codeGen);
+		RecordLengthStats(codeGen, options, res);
+		codeGen.phases = PhaseTimes();
+		if (res != z3::sat)
+		{
+			PrintNotSatisfied(codeGen, res);
+			continue;
+		}
+
+		printf("  satisified! (%d chains)\n\n", codeGen.numChains);
+
+		PrintSolution(codeGen);
+
+		return true;
+	}
+
+	return false;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The values an immediate synthesized at bitWidth bits could correspond to at 32 bits
+std::vector<ValueType> LiftImmediate(const int bitWidth, const ValueType imm, const bool isShift)
+{
+	std::vector<ValueType> candidates;
+	auto addCandidate = [&](const ValueType v)
+	{
+		if (std::find(candidates.begin(), candidates.end(), v) == candidates.end())
+		{
+			candidates.push_back(v);
+		}
+	};
+
+	const uint32_t mask = (1u << bitWidth) - 1;
+	if (isShift)
+	{
+		// shifting by (width - 1) is almost always extracting the sign bit
+		if (imm == bitWidth - 1)
+		{
+			addCandidate(31);
+		}
+
+		addCandidate(imm);
+		addCandidate((imm * 32) / bitWidth);
+	}
+	else
+	{
+		addCandidate(imm);
+		addCandidate(static_cast<ValueType>((uint32_t)imm & mask));
+
+		if (imm == bitWidth - 1) addCandidate(31);
+		if (imm == bitWidth) addCandidate(32);
+		if (((uint32_t)imm & mask) == (1u << (bitWidth - 1))) addCandidate(INT_MIN);
+		if (((uint32_t)imm & mask) == (1u << (bitWidth - 1)) - 1) addCandidate(INT_MAX);
+	}
+
+	return candidates;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Try to turn a program synthesized at a narrow bit width into a 32 bit program: the opcodes and register wiring
+// are kept and each combination of the lifted immediates is tested against TargetFunc at 32 bits
+bool LiftProgram(CodeGenContext& codeGen, Program& program)
+{
+	const int setOpCode = ISA_OpCodeForName("set");
+	const std::vector<int> shiftOpCodes = ISA_OpCodesForKindMask(Instruction::Kind_Shift);
+
+	std::vector<int> immIndices;
+	std::vector<std::vector<ValueType>> immCandidates;
+	for (int instrIdx = program.numInputs; instrIdx < program.size(); instrIdx++)
+	{
+		const int opcode = program.opcode[instrIdx];
+		const bool isShift = std::find(shiftOpCodes.begin(), shiftOpCodes.end(), opcode) != shiftOpCodes.end();
+		if (isShift || opcode == setOpCode)
+		{
+			immIndices.push_back(instrIdx);
+			immCandidates.push_back(LiftImmediate(program.bitWidth, program.imm[instrIdx], isShift));
+		}
+	}
+
+	const int MAX_COMBINATIONS = 4096;
+	int numCombinations = 1;
+	for (const auto& candidates: immCandidates)
+	{
+		numCombinations = std::min(numCombinations * static_cast<int>(candidates.size()), MAX_COMBINATIONS);
+	}
+
+	const ValueType edgeCases[] = { 0, 1, -1, 2, -2, INT_MAX, INT_MIN, INT_MIN + 1 };
+
+	for (int combination = 0; combination < numCombinations; combination++)
+	{
+		Program lifted = program;
+		lifted.bitWidth = 32;
+
+		int remainder = combination;
+		for (int i = 0; i < static_cast<int>(immIndices.size()); i++)
+		{
+			const auto& candidates = immCandidates[i];
+			lifted.imm[immIndices[i]] = candidates[remainder % candidates.size()];
+			remainder /= static_cast<int>(candidates.size());
+		}
+
+		bool passed = true;
+		for (const ValueType x: edgeCases)
+		{
+			passed = passed && lifted.evaluate(&x) == codeGen.target(x);
+		}
+
+		ValueType counterExample = 0;
+		passed = passed && TestProgram(codeGen, lifted, NUM_TESTS, counterExample) == NUM_TESTS;
+
+		if (passed)
+		{
+			program = lifted;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Synthesize at each of the narrow bit widths in turn: a satisfiable narrow program is lifted to 32 bits and 
+// verified, if lifting fails the next wider width is tried with the full 32 bit solve as the final fallback. 
+// Unsatisfiable at a narrow width doesn't rule out a 32 bit program (it may need a constant or shift amount which
+// doesn't fit) so the next width is tried as well, only the 32 bit solve can prove the length unsatisfiable.
+z3::check_result FindSolutionNarrow(const int numInstructions, const ISASubset& isa, const SynthOptions& options, Program* foundProgram = nullptr)
+{
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+
+	std::vector<int> widths = options.narrowWidths;
+	widths.push_back(32);
+
+	for (const int bitWidth: widths)
+	{
+		z3::context ctx;
+		CodeGenContext codeGen(ctx, numInputs, numInstructions, isa, options, bitWidth);
+
+		printf("  %d bits:\n", bitWidth);
+		const auto res = SolveLength(codeGen, numChains);
+		RecordLengthStats(codeGen, options, res);
+		if (res != z3::sat)
+		{
+			PrintNotSatisfied(codeGen, res);
+			if (bitWidth == 32)
+			{
+				return res;
+			}
+
+			continue;
+		}
+
+		if (bitWidth == 32)
+		{
+			printf("  satisified! (%d chains)\n\n", codeGen.numChains);
+
+			PrintSolution(codeGen);
+
+			if (foundProgram)
+			{
+				*foundProgram = DecodeProgram(codeGen);
+			}
+
+			return z3::sat;
+		}
+
+		Program program = DecodeProgram(codeGen);
+		if (!LiftProgram(codeGen, program))
+		{
+			printf("  satisfied at %d bits but could not be lifted to 32 bits\n", bitWidth);
+			continue;
+		}
+
+		printf("  satisified! (lifted from %d bits)\n\n", bitWidth);
+
+		program.print();
+
+		printf("Testing with random values...\n");
+		printf("  %d / %d passed\n\n", NUM_TESTS, NUM_TESTS);
+
+		if (options.exhaustive && !VerifyExhaustive(program, options))
+		{
+			printf("  program rejected\n");
+			continue;
+		}
+
+		if (foundProgram)
+		{
+			*foundProgram = program;
+		}
+
+		return z3::sat;
+	}
+
+	// not reached, the 32 bit width is always last and always returns
+	return z3::unknown;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Try to find the program by enumerating the short programs directly, which avoids creating a context and 
+// bit-blasting the encoding for targets which only need a few instructions
+bool FindSolutionEnumerate(const int minInstructions, const ISASubset& isa, const SynthOptions& options, Program* foundProgram = nullptr)
+{
+	printf("Enumerating lengths %d to %d...\n", minInstructions, options.enumeration.maxLength);
+
+	Program program;
+	EnumerateStats stats;
+	const bool found = EnumerateProgram(isa, options.target, minInstructions, options.enumeration, program, stats);
+
+	printf("  %lld candidates, %lld programs kept: %lld ms\n", stats.numCandidates, stats.numStates, stats.timeMs);
+	if (!found)
+	{
+		printf(stats.outOfBudget ? "  out of time at length %d, using the solver\n\n" : "  not found up to length %d, using the solver\n\n", stats.lengthReached);
+		return false;
+	}
+
+	printf("  found with %d instructions!\n\n", program.size());
+
+	program.print();
+
+	printf("Testing with random values...\n");
+	printf("  %d / %d passed\n\n", NUM_TESTS, NUM_TESTS);
+
+	if (options.exhaustive && !VerifyExhaustive(program, options))
+	{
+		printf("  program rejected, using the solver\n\n");
+		return false;
+	}
+
+	if (foundProgram)
+	{
+		*foundProgram = program;
+	}
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Search for a program of the given length with the MCMC search rather than the solver. A candidate is confirmed by
+// proving it equivalent to the target with the solver, targets which are only native code or tables have no solver
+// expression so for them all 2^32 inputs are checked instead. When a candidate is wrong the inputs it fails on are 
+// added to every chain's test vectors and the search is run again with the rest of the time budget.
+bool FindSolutionStochastic(const int numInstructions, const ISASubset& isa, const SynthOptions& options, Program* foundProgram = nullptr)
+{
+	StochasticOptions stochasticOptions = options.stochastic;
+	stochasticOptions.numChains = options.numThreads;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned round = 0; ; round++)
+	{
+		const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+		stochasticOptions.timeBudgetMs = options.stochastic.timeBudgetMs - std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+		if (stochasticOptions.timeBudgetMs <= 0)
+		{
+			printf("  out of time\n");
+			return false;
+		}
+
+		// a new seed for each round so the chains don't retrace the previous round's search
+		stochasticOptions.seed = options.seed + 0x7f4a7c15u * round;
+
+		Program program;
+		StochasticStats stats;
+		const bool found = StochasticSearch(isa, options.target, numInstructions, stochasticOptions, program, stats);
+
+		printf("  %d chains, %lld iterations: %lld ms\n", stochasticOptions.numChains, stats.numIterations, stats.timeMs);
+		if (!found)
+		{
+			printf("  not found, best cost %d bits\n", stats.bestCost);
+			return false;
+		}
+
+		printf("  found!\n\n");
+
+		program.print();
+
+		printf("Testing with random values...\n");
+		printf("  %d / %d passed\n\n", NUM_TESTS, NUM_TESTS);
+
+		std::vector<ValueType> counterExamples;
+		const bool equivalent = options.simTarget ? 
+			VerifyEquivalent(program, options, &counterExamples) : VerifyExhaustive(program, options, &counterExamples);
+		if (equivalent)
+		{
+			if (foundProgram)
+			{
+				*foundProgram = program;
+			}
+
+			return true;
+		}
+
+		// the solver couldn't decide, there is nothing to learn from the candidate
+		if (counterExamples.empty())
+		{
+			printf("  candidate rejected\n");
+			return false;
+		}
+
+		printf("  candidate rejected, searching again with its counterexamples\n");
+		stochasticOptions.testInputs.insert(stochasticOptions.testInputs.end(), counterExamples.begin(), counterExamples.end());
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A solver statistic by name, 0 if the solver hasn't reported it
+static double SolverStatistic(const z3::solver& solver, const char* key)
+{
+	const z3::stats stats = solver.statistics();
+	for (unsigned i = 0; i < stats.size(); i++)
+	{
+		if (stats.key(i) == key)
+		{
+			return stats.is_uint(i) ? stats.uint_value(i) : stats.double_value(i);
+		}
+	}
+
+	return 0.0;
+}
+
+LengthSearchResult SearchLengths(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options)
+{
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+
+	LengthSearchResult result;
+	for (int numInstr = minInstructions; numInstr < maxInstructions; numInstr++)
+	{
+		z3::context ctx;
+		CodeGenContext codeGen(ctx, numInputs, numInstr, isa, options);
+		codeGen.verbose = false;
+
+		const auto res = SolveLength(codeGen, numChains);
+		RecordLengthStats(codeGen, options, res);
+		result.solveTimeMs += codeGen.solveTimeMs;
+		result.memoryMb = std::max(result.memoryMb, SolverStatistic(codeGen.solver, "memory"));
+		result.numUnknown += res == z3::unknown ? 1 : 0;
+		if (res == z3::sat)
+		{
+			ValueType counterExample = 0;
+			result.length = numInstr;
+			result.program = DecodeProgram(codeGen);
+			result.numPassed = TestProgram(codeGen, result.program, NUM_TESTS, counterExample);
+			break;
+		}
+	}
+
+	return result;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Run the length search for each of the builtin targets with each index encoding and report the total solve time
+void CompareEncodings(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options)
+{
+	const IndexEncoding encodings[] = { IndexEncoding::Int, IndexEncoding::BitVector, IndexEncoding::OneHot };
+
+	printf("Comparing encodings, lengths %d to %d...\n\n", minInstructions, maxInstructions - 1);
+	printf("  %-12s", "target");
+	for (const IndexEncoding encoding: encodings)
+	{
+		printf("  %16s", IndexEncodingNames[static_cast<int>(encoding)]);
+	}
+	printf("  fastest\n");
+
+	for (const auto& target: BuiltinTargets)
+	{
+		printf("  %-12s", target.name);
+		fflush(stdout);
+
+		long long bestTimeMs = LLONG_MAX;
+		const char* bestName = "-";
+		for (const IndexEncoding encoding: encodings)
+		{
+			SynthOptions encodingOptions = options;
+			encodingOptions.target = target.func;
+			encodingOptions.simTarget = target.sim;
+			encodingOptions.encoding = encoding;
+
+			const LengthSearchResult result = SearchLengths(minInstructions, maxInstructions, isa, encodingOptions);
+			if (result.length < 0)
+			{
+				printf("  %16s", "no solution");
+			}
+			else
+			{
+				char cell[32];
+				sprintf(cell, "len %d, %lld ms", result.length, result.solveTimeMs);
+				printf("  %16s", cell);
+
+				if (result.solveTimeMs < bestTimeMs)
+				{
+					bestTimeMs = result.solveTimeMs;
+					bestName = IndexEncodingNames[static_cast<int>(encoding)];
+				}
+			}
+
+			fflush(stdout);
+		}
+
+		printf("  %s\n", bestName);
+	}
+
+	printf("\n");
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct TuneJob
+{
+	SolverPipeline      pipeline = SolverPipeline::Default;
+	z3::context*        ctx = nullptr;
+	z3::check_result    res = z3::unknown;
+	long long           solveTimeMs = 0;
+	std::string         error;
+};
+
+// Don't settle on a pipeline from a length which every pipeline solves almost instantly
+const long long TUNE_MIN_SOLVE_MS = 50;
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Race all the solver pipelines from minInstructions upwards, each pipeline has its own context and thread and the
+// first to finish interrupts the others. This stops at the first unsatisfiable length which takes the winner at least
+// TUNE_MIN_SOLVE_MS or at the first satisfiable length, the fastest pipeline is stored in options.pipeline for the 
+// rest of the run. Returns the first length which wasn't proven unsatisfiable.
+int TuneSolverPipeline(const int minInstructions, const int maxInstructions, const ISASubset& isa, SynthOptions& options)
+{
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+	const int numPipelines = static_cast<int>(SolverPipeline::Auto);
+
+	printf("Racing %d solver pipelines...\n", numPipelines);
+
+	SolverPipeline best = SolverPipeline::Default;
+	int numInstr = minInstructions;
+	for (; numInstr < maxInstructions; numInstr++)
+	{
+		std::vector<TuneJob> jobs(numPipelines);
+		std::mutex mutex;
+		int winner = -1;
+
+		{
+			// one thread per pipeline so they really are racing
+			ThreadPool pool(numPipelines);
+			for (int i = 0; i < numPipelines; i++)
+			{
+				jobs[i].pipeline = static_cast<SolverPipeline>(i);
+				pool.submit([&, i]()
+				{
+					TuneJob& job = jobs[i];
+					std::unique_ptr<z3::context> ctx(new z3::context);
+
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						if (winner >= 0)
+						{
+							return;
+						}
+
+						job.ctx = ctx.get();
+					}
+
+					auto res = z3::unknown;
+					try
+					{
+						SynthOptions pipelineOptions = options;
+						pipelineOptions.pipeline = job.pipeline;
+
+						CodeGenContext codeGen(*ctx, numInputs, numInstr, isa, pipelineOptions);
+						codeGen.verbose = false;
+
+						res = SolveLength(codeGen, numChains);
+						job.solveTimeMs = codeGen.solveTimeMs;
+					}
+					catch (z3::exception& e)
+					{
+						job.error = e.msg();
+					}
+
+					std::lock_guard<std::mutex> lock(mutex);
+					job.ctx = nullptr;
+					job.res = res;
+					if (res != z3::unknown && winner < 0)
+					{
+						winner = i;
+						for (TuneJob& other: jobs)
+						{
+							if (other.ctx)
+							{
+								other.ctx->interrupt();
+							}
+						}
+					}
+				});
+			}
+
+			pool.wait();
+		}
+
+		if (winner < 0)
+		{
+			printf("  %d instructions: no pipeline finished\n", numInstr);
+			break;
+		}
+
+		const TuneJob& winning = jobs[winner];
+		best = winning.pipeline;
+		printf("  %d instructions: %s, %s won in %lld ms\n", numInstr, winning.res == z3::sat ? "satisfiable" : "unsatisfiable",
+			SolverPipelineNames[winner], winning.solveTimeMs);
+
+		if (winning.res == z3::sat || winning.solveTimeMs >= TUNE_MIN_SOLVE_MS)
+		{
+			if (winning.res == z3::unsat)
+			{
+				numInstr++;
+			}
+
+			break;
+		}
+	}
+
+	options.pipeline = best;
+	printf("Using the %s pipeline\n\n", SolverPipelineNames[static_cast<int>(best)]);
+	return numInstr;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The retries of the lengths which ran out of time get this many times the per length budget
+const int RETRY_TIMEOUT_SCALE = 4;
+
+// Retry the lengths which ran out of time and are shorter than the program which was found, all at once on the 
+// thread pool after the program has been reported. Each retry gets RETRY_TIMEOUT_SCALE times the per length budget 
+// and is still bounded by the deadline for the run. When a retry is satisfied the shortest program is printed and 
+// stored in shorter. Returns true if every retried length was proven unsatisfiable.
+bool RetrySkippedLengths(const std::vector<int>& lengths, const ISASubset& isa, const SynthOptions& options, Program& shorter)
+{
+	SynthOptions retryOptions = options;
+	retryOptions.lengthTimeoutMs *= RETRY_TIMEOUT_SCALE;
+	retryOptions.statsLog = nullptr;
+
+	std::vector<LengthSearchResult> results(lengths.size());
+	std::mutex mutex;
+
+	{
+		ThreadPool pool(options.numThreads);
+		printf("Retrying them in the background on %d threads...\n", pool.size());
+
+		for (size_t i = 0; i < lengths.size(); i++)
+		{
+			pool.submit([&, i]()
+			{
+				LengthSearchResult result;
+				try
+				{
+					result = SearchLengths(lengths[i], lengths[i] + 1, isa, retryOptions);
+				}
+				catch (z3::exception&)
+				{
+					result.numUnknown = 1;
+				}
+
+				std::lock_guard<std::mutex> lock(mutex);
+				printf("  %d instructions: %s\n", lengths[i], 
+					result.length > 0 ? "satisified!" : result.numUnknown > 0 ? "still unknown" : "unsatifiable");
+				results[i] = result;
+			});
+		}
+
+		pool.wait();
+	}
+
+	bool allUnsat = true;
+	for (const LengthSearchResult& result: results)
+	{
+		allUnsat = allUnsat && result.length < 0 && result.numUnknown == 0;
+		if (result.length > 0 && result.numPassed == NUM_TESTS && (shorter.size() == 0 || result.length < shorter.size()))
+		{
+			shorter = result.program;
+		}
+	}
+
+	if (shorter.size() > 0)
+	{
+		printf("\nShorter program found with %d instructions\n\n", shorter.size());
+		shorter.print();
+	}
+
+	return allUnsat;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Writes the stats log when main returns, whichever mode was run
+struct StatsLogWriter
+{
+	StatsLog            log;
+	const char*         path = nullptr;
+	std::vector<std::string> args;
+
+	~StatsLogWriter()
+	{
+		if (path && !log.write(path, args))
+		{
+			printf("Couldn't write stats: %s\n", path);
+		}
+	}
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+int main(int argc, char** argv)
+{
+	int minInstructions = 2;
+	int maxInstructions = 8;
+	SynthOptions options;
+	options.target = TargetFunc<ValueType>;
+	options.simTarget = TargetFunc<z3::expr>;
+	bool useIncremental = false;
+	int rankMax = 0;
+	const char* rankOutPath = "ranked.c";
+	bool usePortfolio = false;
+	bool compareEncodings = false;
+	int exploreSubsetSize = 0;
+	const char* cachePath = nullptr;
+	const char* sketchPath = nullptr;
+	const char* batchPath = nullptr;
+	std::string batchOutPath;
+	long long totalTimeoutMs = 0;
+	int benchRuns = 0;
+	const char* benchOutPath = nullptr;
+	StatsLogWriter stats;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--cegis") == 0)
+		{
+			options.useCEGIS = true;
+		}
+		else if (strcmp(argv[i], "--incremental") == 0)
+		{
+			useIncremental = true;
+		}
+		else if (strcmp(argv[i], "--rank") == 0)
+		{
+			rankMax = std::max(rankMax, 32);
+		}
+		else if (strcmp(argv[i], "--rank-max") == 0 && i + 1 < argc)
+		{
+			rankMax = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--rank-out") == 0 && i + 1 < argc)
+		{
+			rankOutPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--portfolio") == 0)
+		{
+			usePortfolio = true;
+		}
+		else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc)
+		{
+			minInstructions = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+		{
+			// inclusive on the command line
+			maxInstructions = atoi(argv[++i]) + 1;
+		}
+		else if (strcmp(argv[i], "--narrow") == 0 && i + 1 < argc)
+		{
+			// comma separated list of widths, e.g. 4,8,12
+			for (char* width = strtok(argv[++i], ","); width; width = strtok(nullptr, ","))
+			{
+				options.narrowWidths.push_back(std::max(4, std::min(atoi(width), 31)));
+			}
+		}
+		else if (strcmp(argv[i], "--target") == 0 && i + 1 < argc)
+		{
+			const BuiltinTarget* target = TargetForName(argv[++i]);
+			if (!target)
+			{
+				printf("Unknown target: %s\n", argv[i]);
+				return 1;
+			}
+
+			options.target = target->func;
+			options.simTarget = target->sim;
+		}
+		else if (strcmp(argv[i], "--forall") == 0)
+		{
+			options.useForall = true;
+		}
+		else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc)
+		{
+			options.shardDepth = std::max(1, std::min(atoi(argv[++i]), 2));
+		}
+		else if (strcmp(argv[i], "--encoding") == 0 && i + 1 < argc)
+		{
+			if (!ParseIndexEncoding(argv[++i], options.encoding))
+			{
+				printf("Unknown encoding: %s (expected int, bv or onehot)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--chain-encoding") == 0 && i + 1 < argc)
+		{
+			if (!ParseChainEncoding(argv[++i], options.chainEncoding))
+			{
+				printf("Unknown chain encoding: %s (expected mux or location)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--inputs") == 0 && i + 1 < argc)
+		{
+			if (!ParseInputSelection(argv[++i], options.inputSelection))
+			{
+				printf("Unknown input selection: %s (expected random, edge or adaptive)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--solver") == 0 && i + 1 < argc)
+		{
+			if (!ParseSolverPipeline(argv[++i], options.pipeline))
+			{
+				printf("Unknown solver: %s (expected default, qfbv, bitblast, bitblast-aig, qfbv-tactic or auto)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--solver-param") == 0 && i + 1 < argc)
+		{
+			// global so the parameter applies to every context, e.g. sat.restart=luby or smt.phase_selection=0
+			std::string param = argv[++i];
+			const size_t equals = param.find('=');
+			if (equals == std::string::npos)
+			{
+				printf("Expected name=value: %s\n", param.c_str());
+				return 1;
+			}
+
+			z3::set_param(param.substr(0, equals).c_str(), param.substr(equals + 1).c_str());
+		}
+		else if (strcmp(argv[i], "--cost") == 0 && i + 1 < argc)
+		{
+			if (!ParseCostObjective(argv[++i], options.costObjective))
+			{
+				printf("Unknown cost: %s (expected length, latency or throughput)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--symmetry") == 0)
+		{
+			options.symmetryBreaking = true;
+		}
+		else if (strcmp(argv[i], "--exhaustive") == 0)
+		{
+			options.exhaustive = true;
+		}
+		else if (strcmp(argv[i], "--enumerate") == 0)
+		{
+			options.useEnumeration = true;
+		}
+		else if (strcmp(argv[i], "--enum-max") == 0 && i + 1 < argc)
+		{
+			// inclusive like --max
+			options.enumeration.maxLength = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--enum-imm") == 0 && i + 1 < argc)
+		{
+			// lo,hi
+			const char* lo = strtok(argv[++i], ",");
+			const char* hi = strtok(nullptr, ",");
+			options.enumeration.minImm = lo ? atoi(lo) : 0;
+			options.enumeration.maxImm = hi ? atoi(hi) : options.enumeration.minImm;
+		}
+		else if (strcmp(argv[i], "--enum-time") == 0 && i + 1 < argc)
+		{
+			options.enumeration.timeBudgetMs = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--stochastic") == 0)
+		{
+			options.useStochastic = true;
+		}
+		else if (strcmp(argv[i], "--stochastic-time") == 0 && i + 1 < argc)
+		{
+			options.stochastic.timeBudgetMs = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--stochastic-beta") == 0 && i + 1 < argc)
+		{
+			options.stochastic.beta = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--compare-encodings") == 0)
+		{
+			compareEncodings = true;
+		}
+		else if (strcmp(argv[i], "--explore") == 0 && i + 1 < argc)
+		{
+			exploreSubsetSize = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+		{
+			batchPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--batch-out") == 0 && i + 1 < argc)
+		{
+			batchOutPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+		{
+			cachePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--sketch") == 0 && i + 1 < argc)
+		{
+			sketchPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			options.numThreads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+		{
+			benchRuns = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc)
+		{
+			benchOutPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--length-timeout") == 0 && i + 1 < argc)
+		{
+			options.lengthTimeoutMs = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+		{
+			totalTimeoutMs = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc)
+		{
+			// Z3's own allocations in MB, a check which reaches the limit returns unknown
+			z3::set_param("memory_max_size", argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			options.seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 0));
+		}
+		else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+		{
+			stats.path = argv[++i];
+			stats.args.assign(argv, argv + argc);
+			options.statsLog = &stats.log;
+		}
+		else
+		{
+			printf("Unknown option: %s\n", argv[i]);
+			printf("Usage: codegen [--target name] [--min n] [--max n] [--encoding int|bv|onehot] [--chain-encoding mux|location] [--inputs random|edge|adaptive] [--solver default|qfbv|bitblast|bitblast-aig|qfbv-tactic|auto] [--solver-param name=value] [--compare-encodings] [--cost length|latency|throughput] [--symmetry] [--exhaustive] [--enumerate] [--enum-max n] [--enum-imm lo,hi] [--enum-time ms] [--stochastic] [--stochastic-time ms] [--stochastic-beta b] [--cegis] [--forall] [--sketch file] [--shard 1|2] [--incremental] [--rank] [--rank-max n] [--rank-out file] [--portfolio] [--explore k] [--narrow w0,w1,..] [--cache file] [--batch file] [--batch-out file] [--threads n] [--seed n] [--length-timeout ms] [--timeout ms] [--memory-limit mb] [--bench runs] [--bench-out file] [--stats file]\n");
+			return 1;
+		}
+	}
+
+	if (EncodingForPipeline(options.encoding, options.pipeline) != options.encoding)
+	{
+		printf("Using the bv encoding, the %s solver can't handle integers\n", SolverPipelineNames[static_cast<int>(options.pipeline)]);
+	}
+
+	if (options.useForall && !options.simTarget)
+	{
+		printf("--forall needs a target which can be written as a solver expression\n");
+		return 1;
+	}
+
+	// must outlive every context it watches
+	std::unique_ptr<Watchdog> watchdog;
+	if (options.lengthTimeoutMs > 0 || totalTimeoutMs > 0)
+	{
+		watchdog.reset(new Watchdog);
+		options.watchdog = watchdog.get();
+		if (totalTimeoutMs > 0)
+		{
+			options.deadline = Watchdog::Clock::now() + std::chrono::milliseconds(totalTimeoutMs);
+		}
+	}
+
+	// Don't need to always use the full ISA
+	ISASubset isa;
+	isa.addOpcode(ISA_OpCodeForName("set"));
+//	isa.addOpcode(ISA_OpCodeForName("add"));
+	isa.addOpcode(ISA_OpCodeForName("sub"));
+	isa.addOpcode(ISA_OpCodeForName("xor"));
+//	isa.addOpcode(ISA_OpCodeForName("shr"));
+	isa.addOpcode(ISA_OpCodeForName("gt"));
+
+	// must outlive every context which refers to it
+	Sketch sketch;
+	if (sketchPath)
+	{
+		if (!LoadSketch(sketchPath, sketch))
+		{
+			return 1;
+		}
+
+		// the opcodes the sketch names are searched even if they aren't in the subset
+		for (const int opcode: sketch.opcodes())
+		{
+			if (isa.opCodeForName(ISA_OpName(opcode)) < 0)
+			{
+				isa.addOpcode(opcode);
+			}
+		}
+
+		// a length which is unsatisfiable for the sketch may not be for the target
+		if (cachePath)
+		{
+			printf("The cache isn't used with a sketch\n");
+			cachePath = nullptr;
+		}
+
+		options.sketch = &sketch;
+	}
+
+	if (compareEncodings)
+	{
+		CompareEncodings(minInstructions, maxInstructions, isa, options);
+		return 0;
+	}
+
+	if (benchRuns > 0)
+	{
+		return RunBenchmarks(benchRuns, benchOutPath, minInstructions, maxInstructions, options) ? 0 : 1;
+	}
+
+	if (batchPath)
+	{
+		if (batchOutPath.empty())
+		{
+			batchOutPath = std::string(batchPath) + ".json";
+		}
+
+		return RunBatch(batchPath, batchOutPath.c_str(), minInstructions, maxInstructions, isa, options) ? 0 : 1;
+	}
+
+	if (exploreSubsetSize > 0)
+	{
+		ExploreISASubsets(exploreSubsetSize, minInstructions, maxInstructions, options);
+		return 0;
+	}
+
+	// results are cached for 32 bit programs, only the verified programs and the unsatisfiable lengths found by
+	// the per length search (which are proofs) are recorded
+	ResultCache cache;
+	const CacheKey cacheKey = MakeCacheKey(options.target, isa, 32);
+	if (cachePath)
+	{
+		if (!cache.open(cachePath))
+		{
+			printf("Couldn't open cache: %s\n", cachePath);
+			return 1;
+		}
+
+		// records written before only proven programs were kept may hold a program which isn't the shortest
+		const CacheRecord* record = cache.lookup(cacheKey);
+		if (record && record->length >= minInstructions && record->length < maxInstructions && 
+			CacheRecord::isShortest(record->length, record->unsatLength))
+		{
+			printf("Found in cache with %d instructions\n\n", record->length);
+
+			const Program program = record->program();
+			program.print();
+
+			if (VerifyCachedProgram(program, isa, options))
+			{
+				return 0;
+			}
+
+			printf("Cached program rejected, searching again\n\n");
+			cache.forgetProgram(cacheKey);
+			record = cache.lookup(cacheKey);
+		}
+
+		if (record && record->unsatLength >= minInstructions)
+		{
+			printf("Lengths %d to %d are unsatisfiable (cached)\n", minInstructions, record->unsatLength);
+			minInstructions = record->unsatLength + 1;
+		}
+	}
+
+	// the cache records that every length up to an unsatisfiable one is unsatisfiable, which is only true when the 
+	// lengths below the first one searched are already known to be
+	const CacheRecord* known = cache.lookup(cacheKey);
+	const bool shorterUnsat = CacheRecord::isShortest(minInstructions, known ? known->unsatLength : 0);
+
+	Program foundProgram;
+	if (options.useEnumeration && FindSolutionEnumerate(minInstructions, isa, options, &foundProgram))
+	{
+		if (cachePath)
+		{
+			cache.recordProgram(cacheKey, foundProgram);
+			cache.save();
+		}
+
+		return 0;
+	}
+
+	if (options.useStochastic)
+	{
+		for (int i = minInstructions; i < maxInstructions; i++)
+		{
+			printf("Try with %d instructions...\n", i);
+			if (FindSolutionStochastic(i, isa, options, &foundProgram))
+			{
+				if (cachePath)
+				{
+					cache.recordProgram(cacheKey, foundProgram);
+					cache.save();
+				}
+
+				break;
+			}
+		}
+
+		return 0;
+	}
+
+	if (options.pipeline == SolverPipeline::Auto)
+	{
+		const int firstLength = TuneSolverPipeline(minInstructions, maxInstructions, isa, options);
+		if (cachePath && shorterUnsat && firstLength > minInstructions)
+		{
+			cache.recordUnsat(cacheKey, firstLength - 1);
+		}
+
+		minInstructions = firstLength;
+	}
+
+	if (rankMax > 0)
+	{
+		try
+		{
+			return RankSolutions(minInstructions, maxInstructions, isa, options, rankMax, rankOutPath) ? 0 : 1;
+		}
+		catch (z3::exception& e)
+		{
+			std::cout << e.msg() << std::endl;
+			return 1;
+		}
+	}
+
+	if (options.costObjective != CostObjective::Length)
+	{
+		FindSolutionCost(minInstructions, maxInstructions, isa, options);
+		return 0;
+	}
+
+	if (usePortfolio)
+	{
+		FindSolutionPortfolio(minInstructions, maxInstructions, isa, options);
+		return 0;
+	}
+
+	if (useIncremental)
+	{
+		try
+		{
+			FindSolutionIncremental(minInstructions, maxInstructions, isa, options);
+		}
+		catch (z3::exception& e)
+		{
+			std::cout << e.msg() << std::endl;
+		}
+
+		return 0;
+	}
+
+	// forked once the options are final so the workers see the same settings, the watchdog thread isn't forked 
+	// with them and the solver's timeout parameter is enough to stop each cube
+	std::unique_ptr<WorkerPool> shardPool;
+	if (options.shardDepth > 0)
+	{
+		SynthOptions cubeOptions = options;
+		cubeOptions.watchdog = nullptr;
+		cubeOptions.statsLog = nullptr;
+		shardPool.reset(new WorkerPool(options.numThreads, [cubeOptions, isa](const std::string& job) 
+		{ 
+			return SolveCube(job, isa, cubeOptions); 
+		}));
+	}
+
+	// the lengths which ran out of time, the longer lengths are still tried so there is a result within the budget
+	std::vector<int> skippedLengths;
+	int foundLength = -1;
+	for (int i = minInstructions; i < maxInstructions; i++)
+	{
+		if (Watchdog::Clock::now() >= options.deadline)
+		{
+			printf("Out of time\n");
+			break;
+		}
+
+		try
+		{
+			printf("Try with %d instructions...\n", i);
+			const z3::check_result res = 
+				options.useForall ? FindSolutionForall(i, isa, options, &foundProgram) :
+				shardPool ? FindSolutionSharded(i, isa, options, *shardPool, &foundProgram) :
+				!options.narrowWidths.empty() ? FindSolutionNarrow(i, isa, options, &foundProgram) :
+				options.useCEGIS ? FindSolutionCEGIS(i, isa, options, &foundProgram) : 
+				FindSolution(i, isa, options, &foundProgram);
+			if (res == z3::sat)
 			{
+				foundLength = i;
+				if (foundProgram.size() > 0)
+				{
+					cache.recordProgram(cacheKey, foundProgram);
+				}
+
 				break;
 			}
+
+			if (res == z3::unknown)
+			{
+				skippedLengths.push_back(i);
+			}
+
+			// the cache records that every length up to the unsatisfiable one is unsatisfiable
+			else if (skippedLengths.empty() && shorterUnsat)
+			{
+				cache.recordUnsat(cacheKey, i);
+			}
 		}
 		catch (z3::exception& e)
 		{
 			std::cout << e.msg() << std::endl;
 		}
 	}
+
+	if (!skippedLengths.empty())
+	{
+		printf("Lengths which ran out of time:");
+		for (const int length: skippedLengths)
+		{
+			printf(" %d", length);
+		}
+
+		printf("\n");
+
+		if (foundLength > 0 && Watchdog::Clock::now() < options.deadline)
+		{
+			Program shorter;
+			const bool allUnsat = RetrySkippedLengths(skippedLengths, isa, options, shorter);
+			if (shorter.size() > 0)
+			{
+				cache.recordProgram(cacheKey, shorter);
+			}
+			else if (allUnsat && shorterUnsat)
+			{
+				cache.recordUnsat(cacheKey, foundLength - 1);
+				cache.recordProgram(cacheKey, foundProgram);
+			}
+		}
+	}
+
+	if (cachePath && !cache.save())
+	{
+		printf("Couldn't write cache: %s\n", cachePath);
+	}
 }
 
 // ====================================================================================================================
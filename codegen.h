@@ -0,0 +1,449 @@
+#ifndef		CODEGEN_H_HAS_BEEN_INCLUDED
+#define		CODEGEN_H_HAS_BEEN_INCLUDED
+
+#include	<z3++.h>
+#include	<vector>
+#include	<random>
+#include	<climits>
+
+#include	"isa.h"
+#include	"program.h"
+#include	"enumerate.h"
+#include	"stochastic.h"
+#include	"stats.h"
+#include	"threadpool.h"
+#include	"watchdog.h"
+#include	"inputs.h"
+#include	"sketch.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// How the opcode and register index variables are represented in the solver
+enum class IndexEncoding
+{
+	Int,                // an unbounded integer constrained to [0, n)
+	BitVector,          // the smallest bit-vector which can hold n-1
+	OneHot,             // n booleans with exactly one set
+};
+
+// How each chain wires the instructions together. Mux selects each operand with an ite chain over the earlier 
+// registers and the result with an ite chain over the opcodes, so every chain adds nested muxes of depth idx for
+// each operand. Location is the component-based synthesis encoding: each instruction's operands and the result of
+// each op on them are values of their own, tied to the registers by "location variable == i implies value == R[i]" 
+// equalities which bit-blast to a few clauses each rather than a mux per bit.
+enum class ChainEncoding
+{
+	Mux,
+	Location,
+};
+
+// What the search minimizes: the number of instructions, or for a fixed maximum length the critical path latency
+// or the sum of the reciprocal throughputs
+enum class CostObjective
+{
+	Length,
+	Latency,
+	Throughput,
+};
+
+// How the inputs for the chains and the tests are chosen
+enum class InputSelection
+{
+	Random,             // uniform over the whole range
+	Edge,               // the points where the target changes behaviour and boundary values as well as random ones
+	Adaptive,           // as Edge and each counterexample is the failing input which the most rejected candidates fail
+};
+
+// How the solver is built, the tactic pipeline used often changes the solve time by an order of magnitude
+enum class SolverPipeline
+{
+	Default,            // z3::solver(ctx), Z3 picks a strategy from the formula
+	QFBV,               // the solver for the QF_BV logic
+	BitBlast,           // simplify, propagate-values, solve-eqs, bit-blast then the SAT solver
+	BitBlastAIG,        // as BitBlast with the AIG simplifier before the SAT solver
+	QFBVTactic,         // Z3's qfbv tactic, which also tries to solve without bit-blasting first
+	Auto,               // race the others on the first length and use the fastest for the rest of the run
+};
+
+z3::solver CreateSolver(z3::context& ctx, const SolverPipeline pipeline);
+
+// The bit-blasting pipelines can't handle integer terms so they use bit-vector index variables instead
+IndexEncoding EncodingForPipeline(const IndexEncoding encoding, const SolverPipeline pipeline);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A solver variable which selects one of [0, range), i.e. an opcode or a register index
+class IndexVar
+{
+public:
+
+	IndexVar(z3::context& ctx, const char* name, const int range, const IndexEncoding encoding)
+		: encoding_(encoding)
+		, range_(std::max(range, 1))
+		, var_(ctx)
+		, bits_(ctx)
+	{
+		switch (encoding_)
+		{
+		case IndexEncoding::Int:
+			var_ = ctx.int_const(name);
+			break;
+
+		case IndexEncoding::BitVector:
+			var_ = ctx.bv_const(name, numBits());
+			break;
+
+		case IndexEncoding::OneHot:
+			for (int i = 0; i < range_; i++)
+			{
+				char bitName[32];
+				sprintf(bitName, "%s_%d", name, i);
+				bits_.push_back(ctx.bool_const(bitName));
+			}
+			break;
+		}
+	}
+
+	z3::expr eq(const int value) const
+	{
+		z3::context& ctx = bits_.ctx();
+		if (value < 0 || value >= range_)
+		{
+			return ctx.bool_val(false);
+		}
+
+		switch (encoding_)
+		{
+		case IndexEncoding::Int:        return var_ == value;
+		case IndexEncoding::BitVector:  return var_ == ctx.bv_val(value, numBits());
+		default:                        return bits_[value];
+		}
+	}
+
+	z3::expr rangeConstraint() const
+	{
+		z3::context& ctx = bits_.ctx();
+		switch (encoding_)
+		{
+		case IndexEncoding::Int:        
+			return var_ >= 0 && var_ < range_;
+
+		case IndexEncoding::BitVector:  
+			return (1 << numBits()) == range_ ? ctx.bool_val(true) : z3::ult(var_, ctx.bv_val(range_, numBits()));
+
+		default:
+			return z3::mk_or(bits_) && z3::atmost(bits_, 1);
+		}
+	}
+
+	// Only valid for two variables with the same range
+	z3::expr lessEq(const IndexVar& other) const
+	{
+		switch (encoding_)
+		{
+		case IndexEncoding::Int:        
+			return var_ <= other.var_;
+
+		case IndexEncoding::BitVector:  
+			return z3::ule(var_, other.var_);
+
+		default:
+			z3::expr_vector cases(bits_.ctx());
+			for (int i = 0; i < range_; i++)
+			{
+				z3::expr_vector otherGreaterEq(bits_.ctx());
+				for (int j = i; j < range_; j++)
+				{
+					otherGreaterEq.push_back(other.bits_[j]);
+				}
+
+				cases.push_back(bits_[i] && z3::mk_or(otherGreaterEq));
+			}
+
+			return z3::mk_or(cases);
+		}
+	}
+
+	int decode(const z3::model& model) const
+	{
+		switch (encoding_)
+		{
+		case IndexEncoding::Int:        
+			return model.eval(var_, true).get_numeral_int();
+
+		case IndexEncoding::BitVector:  
+			return static_cast<int>(model.eval(var_, true).get_numeral_uint());
+
+		default:
+			for (int i = 0; i < range_; i++)
+			{
+				if (model.eval(bits_[i], true).is_true())
+				{
+					return i;
+				}
+			}
+
+			return 0;
+		}
+	}
+
+private:
+
+	int numBits() const
+	{
+		int n = 1;
+		while ((1 << n) < range_)
+		{
+			n++;
+		}
+
+		return n;
+	}
+
+	IndexEncoding       encoding_;
+	int                 range_;
+	z3::expr            var_;
+	z3::expr_vector     bits_;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct SynthOptions
+{
+	// TargetFunc in codegen.cpp unless --target, a batch spec or a benchmark sets another
+	TargetFn            target;
+
+	// the target as a solver expression for --forall, null for targets which are only native code or tables
+	SimTargetFn         simTarget;
+
+	// when not empty the target is only defined for these inputs
+	std::vector<ValueType> inputDomain;
+	InputSelection      inputSelection = InputSelection::Random;
+
+	bool                useCEGIS = false;
+	bool                useForall = false;
+
+	// when > 0 each length is split into cubes by fixing the opcodes and operands of the first shardDepth 
+	// instructions and the cubes are solved by worker processes
+	int                 shardDepth = 0;
+	IndexEncoding       encoding = IndexEncoding::Int;
+	ChainEncoding       chainEncoding = ChainEncoding::Mux;
+	SolverPipeline      pipeline = SolverPipeline::Default;
+	std::vector<int>    narrowWidths;
+	bool                symmetryBreaking = false;
+	bool                exhaustive = false;
+
+	// the parts of the program which are already known, null to search every program
+	const Sketch*       sketch = nullptr;
+	CostObjective       costObjective = CostObjective::Length;
+
+	// when set each solved length is recorded with its phase times, formula size and solver statistics
+	StatsLog*           statsLog = nullptr;
+	bool                useEnumeration = false;
+	EnumerateOptions    enumeration;
+	bool                useStochastic = false;
+	StochasticOptions   stochastic;
+	int                 numThreads = ThreadPool::defaultNumThreads();
+
+	// seeds the random chain and test inputs and the solver's own random choices
+	unsigned            seed = std::mt19937::default_seed;
+
+	// a length which isn't solved within lengthTimeoutMs (0 for no limit) or by the deadline for the whole run is 
+	// reported as unknown, the watchdog interrupts the solver if it doesn't stop by itself
+	long long           lengthTimeoutMs = 0;
+	Watchdog::Clock::time_point deadline = Watchdog::Clock::time_point::max();
+	Watchdog*           watchdog = nullptr;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+using expr_vector_array = std::vector<z3::expr_vector>;
+
+class CodeGenContext
+{
+public:
+
+	CodeGenContext(z3::context& _ctx, const int _numInputs, const int _numSteps, const ISASubset& _isa, const SynthOptions& _options, const int _bitWidth = 32)
+		: ctx(_ctx)
+		, solver(CreateSolver(_ctx, _options.pipeline))
+		, numInputs(_numInputs)
+		, numInstr(_numSteps)
+		, bitWidth(_bitWidth)
+		, target(_options.target)
+		, inputDomain(_options.inputDomain)
+		, encoding(EncodingForPipeline(_options.encoding, _options.pipeline))
+		, chainEncoding(_options.chainEncoding)
+		, symmetryBreaking(_options.symmetryBreaking)
+		, sketch(_options.sketch)
+		, imm32(_ctx)
+		, isa(_isa)
+	{
+		prng.seed(_options.seed);
+
+		z3::params params(ctx);
+		params.set("random_seed", _options.seed);
+		solver.set(params);
+
+		if (_options.inputSelection != InputSelection::Random && inputDomain.empty())
+		{
+			interestingInputs = InterestingInputs(target, bitWidth);
+		}
+
+		adaptiveInputs = _options.inputSelection == InputSelection::Adaptive;
+		exhaustive = _options.exhaustive;
+		numThreads = _options.numThreads;
+
+		lengthTimeoutMs = _options.lengthTimeoutMs;
+		runDeadline = _options.deadline;
+		watchdog = _options.watchdog;
+		startLengthTimer();
+	}
+
+	~CodeGenContext()
+	{
+		if (watchdog && watchId >= 0)
+		{
+			watchdog->unwatch(watchId);
+		}
+	}
+
+	CodeGenContext(const CodeGenContext&) = delete;
+	CodeGenContext& operator=(const CodeGenContext&) = delete;
+
+	// Start the time budget for a new length, the incremental search calls this each time an instruction is added
+	void startLengthTimer()
+	{
+		deadline = runDeadline;
+		if (lengthTimeoutMs > 0)
+		{
+			deadline = std::min(deadline, Watchdog::Clock::now() + std::chrono::milliseconds(lengthTimeoutMs));
+		}
+
+		if (watchdog && watchId >= 0)
+		{
+			watchdog->unwatch(watchId);
+			watchId = -1;
+		}
+
+		if (watchdog && deadline != Watchdog::Clock::time_point::max())
+		{
+			watchId = watchdog->watch(ctx, deadline);
+		}
+	}
+
+	z3::context&        ctx;
+	z3::solver          solver;
+	int                 numInputs = 0;
+	int                 numChains = 0;
+	int                 numInstr = 0;
+
+	// the width of the registers and immediates in the encoding, when this is less than 32 the program is 
+	// synthesized for the target function with its inputs and outputs truncated to bitWidth bits
+	int                 bitWidth = 32;
+
+	TargetFn            target;
+	std::vector<ValueType> inputDomain;
+	IndexEncoding       encoding = IndexEncoding::Int;
+	ChainEncoding       chainEncoding = ChainEncoding::Mux;
+
+	// rule out programs which are equivalent to other programs or contain unused instructions
+	bool                symmetryBreaking = false;
+
+	// constrains the instructions it knows about and removes their fixed parts from the chains
+	const Sketch*       sketch = nullptr;
+
+	std::vector<IndexVar> opCode;
+	std::vector<IndexVar> regX;
+	std::vector<IndexVar> regY;
+	z3::expr_vector     imm32;
+	expr_vector_array   R;
+
+	// the input value used to drive each chain, R[c][0] == chainInputs[c]
+	std::vector<ValueType> chainInputs;
+
+	// the change points and boundary values of the target, empty for InputSelection::Random. The first chain still 
+	// uses a random input (a large value constrains every bit of the result), the next chains use these and every
+	// program is tested with them after the random inputs so the counterexamples are mostly random values.
+	std::vector<ValueType> interestingInputs;
+
+	// the candidates which failed the tests, used to pick counterexamples which rule out more than one candidate
+	bool                adaptiveInputs = false;
+	std::vector<Program> rejected;
+
+	// with --exhaustive a program which passes the random tests is also run on all 2^32 inputs before it is accepted,
+	// exhaustiveMs is how long the last sweep took (-1 if there wasn't one) so it can be reported with the program
+	bool                exhaustive = false;
+	int                 numThreads = 1;
+	long long           exhaustiveMs = -1;
+
+	// the chain output constraints are only enforced when this is true, for the incremental search this is an
+	// assumption literal per program length which lets the solver be reused as instructions are added
+	z3::expr            outputGuard = ctx.bool_val(true);
+
+	// each context has its own random number generator so contexts can be used on different threads
+	std::mt19937        prng;
+	std::uniform_int_distribution<ValueType> rndDist { -INT_MAX - 1, INT_MAX };
+
+	// when false nothing is printed while solving, used when running multiple contexts at once
+	bool                verbose = true;
+	long long           solveTimeMs = 0;
+	PhaseTimes          phases;
+
+	long long           lengthTimeoutMs = 0;
+	Watchdog::Clock::time_point runDeadline;
+	Watchdog::Clock::time_point deadline;
+	Watchdog*           watchdog = nullptr;
+	int                 watchId = -1;
+
+	ISASubset           isa;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The number of random values a program has to pass
+const int NUM_TESTS = 10000;
+
+// Building and solving the encoding, see codegen.cpp
+void CreateConstants(CodeGenContext& codeGen);
+void AddConstraints(CodeGenContext& codeGen);
+void AddPerChainConstraints(CodeGenContext& codeGen, const int numChains);
+z3::check_result SolveVerified(CodeGenContext& codeGen);
+z3::check_result SolveLength(CodeGenContext& codeGen, const int numChains);
+Program DecodeProgram(CodeGenContext& codeGen);
+
+// Reporting a length
+std::string UnknownReason(CodeGenContext& codeGen);
+void PrintNotSatisfied(CodeGenContext& codeGen, const z3::check_result res);
+void PrintSolution(const Program& program, const long long exhaustiveMs);
+void PrintSolution(CodeGenContext& codeGen);
+void RecordLengthStats(CodeGenContext& codeGen, const SynthOptions& options, const z3::check_result res);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct LengthSearchResult
+{
+	int                 length = -1;
+	long long           solveTimeMs = 0;
+	Program             program;
+	int                 numPassed = 0;
+
+	// the most memory Z3 was using at the end of any of the lengths
+	double              memoryMb = 0.0;
+
+	// lengths which ran out of time or memory rather than being proven unsatisfiable
+	int                 numUnknown = 0;
+};
+
+// Search the lengths in order without printing anything, used to compare different settings
+LengthSearchResult SearchLengths(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  CODEGEN_H_HAS_BEEN_INCLUDED
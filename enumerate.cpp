@@ -0,0 +1,280 @@
+#include	"enumerate.h"
+
+#include	<algorithm>
+#include	<chrono>
+#include	<climits>
+#include	<random>
+#include	<unordered_set>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const int NUM_TEST_VECTORS = 64;
+static const int NUM_VERIFY_TESTS = 10000;
+
+// A partial program and the values each of its registers holds for the test vectors, the values of register r
+// are values[r * NUM_TEST_VECTORS] -> values[(r + 1) * NUM_TEST_VECTORS - 1]
+struct EnumState
+{
+	Program                 program;
+	std::vector<ValueType>  values;
+};
+
+// An instruction which can be appended to a program, opcode is an ISA[] opcode
+struct EnumInstr
+{
+	int                     opcode;
+	int                     regX;
+	int                     regY;
+	ValueType               imm;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static uint64_t HashValues(const ValueType* values)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (int i = 0; i < NUM_TEST_VECTORS; i++)
+	{
+		hash = (hash ^ static_cast<uint32_t>(values[i])) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Registers can be renamed without changing what a program can compute, so the fingerprint of a program is the
+// sorted list of its register hashes combined
+static uint64_t Fingerprint(const EnumState& state)
+{
+	uint64_t regHashes[Program::MAX_INSTRUCTIONS];
+	const int numRegs = state.program.size();
+	for (int r = 0; r < numRegs; r++)
+	{
+		regHashes[r] = HashValues(&state.values[r * NUM_TEST_VECTORS]);
+	}
+
+	std::sort(regHashes, regHashes + numRegs);
+
+	uint64_t hash = 0;
+	for (int r = 0; r < numRegs; r++)
+	{
+		hash = (hash ^ regHashes[r]) * 0x9e3779b97f4a7c15ull + r;
+	}
+
+	return hash;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static bool VerifyCandidate(const Program& program, TargetFn target, std::mt19937& prng)
+{
+	std::uniform_int_distribution<ValueType> rndDist(INT_MIN, INT_MAX);
+
+	std::vector<ValueType> inputs(NUM_VERIFY_TESTS);
+	std::vector<ValueType> outputs(NUM_VERIFY_TESTS);
+	for (auto& x: inputs)
+	{
+		x = rndDist(prng);
+	}
+
+	program.evaluateBatch(inputs.data(), outputs.data(), NUM_VERIFY_TESTS);
+
+	for (int i = 0; i < NUM_VERIFY_TESTS; i++)
+	{
+		if (outputs[i] != target(inputs[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Every instruction which could be appended to a program with numRegs registers, commutative ops only use
+// regX <= regY and unused operands are 0
+static std::vector<EnumInstr> CandidateInstructions(const ISASubset& isa, const int numRegs, const EnumerateOptions& options)
+{
+	const std::vector<int> shiftOpCodes = ISA_OpCodesForKindMask(Instruction::Kind_Shift);
+	const std::vector<int> commutativeOpCodes = ISA_OpCodesForKindMask(Instruction::Kind_Commutative);
+
+	std::vector<EnumInstr> instrs;
+	for (int localID = 0; localID < isa.size(); localID++)
+	{
+		const int opcode = isa.isaOpCode(localID);
+		const int arity = ISA_OpArity(opcode);
+		const bool isShift = std::find(shiftOpCodes.begin(), shiftOpCodes.end(), opcode) != shiftOpCodes.end();
+		const bool isCommutative = std::find(commutativeOpCodes.begin(), commutativeOpCodes.end(), opcode) != commutativeOpCodes.end();
+
+		std::vector<ValueType> imms;
+		if (isShift)
+		{
+			for (ValueType imm = 1; imm < 32; imm++)
+			{
+				imms.push_back(imm);
+			}
+		}
+		else if (arity == 0)
+		{
+			for (ValueType imm = options.minImm; imm <= options.maxImm; imm++)
+			{
+				imms.push_back(imm);
+			}
+		}
+		else
+		{
+			imms.push_back(0);
+		}
+
+		const int numX = arity >= 1 ? numRegs : 1;
+		for (int x = 0; x < numX; x++)
+		{
+			const int minY = isCommutative ? x : 0;
+			const int numY = arity >= 2 ? numRegs : minY + 1;
+			for (int y = minY; y < numY; y++)
+			{
+				for (const ValueType imm: imms)
+				{
+					instrs.push_back({ opcode, x, arity >= 2 ? y : 0, imm });
+				}
+			}
+		}
+	}
+
+	return instrs;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool EnumerateProgram(const ISASubset& isa, TargetFn target, const int minLength, const EnumerateOptions& options, Program& program, EnumerateStats& stats)
+{
+	const int numInputs = 1;
+	const auto start = std::chrono::high_resolution_clock::now();
+	auto elapsedMs = [&]()
+	{
+		const auto delta = std::chrono::high_resolution_clock::now() - start;
+		return static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(delta).count());
+	};
+
+	std::mt19937 prng;
+	std::uniform_int_distribution<ValueType> rndDist(INT_MIN, INT_MAX);
+
+	// the edge cases are where most wrong programs fail so they are always in the test vectors
+	ValueType testInputs[NUM_TEST_VECTORS] = { 0, 1, -1, 2, -2, 3, -3, INT_MAX, INT_MIN, INT_MAX - 1, INT_MIN + 1 };
+	for (int i = 11; i < NUM_TEST_VECTORS; i++)
+	{
+		testInputs[i] = rndDist(prng);
+	}
+
+	ValueType targetValues[NUM_TEST_VECTORS];
+	for (int i = 0; i < NUM_TEST_VECTORS; i++)
+	{
+		targetValues[i] = target(testInputs[i]);
+	}
+
+	std::vector<EnumState> states(1);
+	states[0].program.numInputs = numInputs;
+	states[0].program.resize(numInputs);
+	states[0].values.assign(testInputs, testInputs + NUM_TEST_VECTORS);
+
+	const int maxLength = std::min(options.maxLength, static_cast<int>(Program::MAX_INSTRUCTIONS));
+	for (int length = numInputs + 1; length <= maxLength; length++)
+	{
+		stats.lengthReached = length;
+
+		const int idx = length - 1;
+		const bool acceptMatch = length >= minLength;
+		const bool keepStates = length < maxLength;
+		const std::vector<EnumInstr> instrs = CandidateInstructions(isa, idx, options);
+
+		std::vector<EnumState> nextStates;
+		std::unordered_set<uint64_t> seen;
+		ValueType out[NUM_TEST_VECTORS];
+
+		for (const EnumState& state: states)
+		{
+			if (elapsedMs() > options.timeBudgetMs)
+			{
+				stats.outOfBudget = true;
+				stats.timeMs = elapsedMs();
+				return false;
+			}
+
+			for (const EnumInstr& instr: instrs)
+			{
+				stats.numCandidates++;
+
+				const ValueType* x = &state.values[instr.regX * NUM_TEST_VECTORS];
+				const ValueType* y = &state.values[instr.regY * NUM_TEST_VECTORS];
+				ISA_EvaluateBatch(instr.opcode, x, y, instr.imm, out, NUM_TEST_VECTORS);
+
+				const bool matches = std::equal(out, out + NUM_TEST_VECTORS, targetValues);
+				if (matches && acceptMatch)
+				{
+					Program candidate = state.program;
+					candidate.resize(length);
+					candidate.opcode[idx] = instr.opcode;
+					candidate.regX[idx] = instr.regX;
+					candidate.regY[idx] = instr.regY;
+					candidate.imm[idx] = instr.imm;
+
+					if (VerifyCandidate(candidate, target, prng))
+					{
+						program = candidate;
+						stats.timeMs = elapsedMs();
+						return true;
+					}
+				}
+
+				if (!keepStates || static_cast<int>(nextStates.size()) >= options.maxStates)
+				{
+					continue;
+				}
+
+				// an instruction which reproduces an existing register doesn't add anything
+				bool isRedundant = false;
+				for (int r = 0; r < length - 1 && !isRedundant; r++)
+				{
+					isRedundant = std::equal(out, out + NUM_TEST_VECTORS, &state.values[r * NUM_TEST_VECTORS]);
+				}
+
+				if (isRedundant)
+				{
+					continue;
+				}
+
+				EnumState next;
+				next.program = state.program;
+				next.program.resize(length);
+				next.program.opcode[idx] = instr.opcode;
+				next.program.regX[idx] = instr.regX;
+				next.program.regY[idx] = instr.regY;
+				next.program.imm[idx] = instr.imm;
+				next.values = state.values;
+				next.values.insert(next.values.end(), out, out + NUM_TEST_VECTORS);
+
+				if (seen.insert(Fingerprint(next)).second)
+				{
+					nextStates.push_back(std::move(next));
+				}
+			}
+		}
+
+		stats.numStates += static_cast<long long>(nextStates.size());
+		states = std::move(nextStates);
+	}
+
+	stats.timeMs = elapsedMs();
+	return false;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
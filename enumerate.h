@@ -0,0 +1,48 @@
+#ifndef		ENUMERATE_H_HAS_BEEN_INCLUDED
+#define		ENUMERATE_H_HAS_BEEN_INCLUDED
+
+#include	"isa.h"
+#include	"program.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct EnumerateOptions
+{
+	// the longest program (including the input) which is enumerated before handing over to the solver
+	int                 maxLength = 5;
+
+	// the immediates tried for "set", shifts always try every shift amount
+	ValueType           minImm = -16;
+	ValueType           maxImm = 16;
+
+	long long           timeBudgetMs = 2000;
+
+	// cap on the number of distinct programs kept for each length
+	int                 maxStates = 1 << 18;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct EnumerateStats
+{
+	int                 lengthReached = 0;
+	long long           numCandidates = 0;
+	long long           numStates = 0;
+	long long           timeMs = 0;
+	bool                outOfBudget = false;
+};
+
+// Enumerate single input programs bottom-up over the ISA subset, shortest first. Each candidate is evaluated on a
+// batch of test vectors and only one program is kept for each distinct set of register values, so programs which
+// behave identically on the test vectors are only extended once. A candidate which matches the target on the test
+// vectors is verified with random inputs. Returns true and sets program if a match was found before the length or
+// time budget ran out. The immediates are limited and the pruning is only exact for the test vectors so not finding
+// a program doesn't mean that none exists.
+bool EnumerateProgram(const ISASubset& isa, TargetFn target, const int minLength, const EnumerateOptions& options, Program& program, EnumerateStats& stats);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  ENUMERATE_H_HAS_BEEN_INCLUDED
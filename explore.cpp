@@ -0,0 +1,236 @@
+#include	"explore.h"
+
+#include	<stdio.h>
+#include	<climits>
+#include	<algorithm>
+#include	<chrono>
+#include	<functional>
+#include	<memory>
+#include	<mutex>
+#include	<string>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct SubsetResult
+{
+	ISASubset                           isa;
+	std::string                         name;
+	int                                 satLength = -1;
+	long long                           satTimeMs = 0;
+	long long                           totalTimeMs = 0;
+	int                                 runningLength = -1;
+	std::unique_ptr<z3::context>        ctx;
+	std::unique_ptr<CodeGenContext>     codeGen;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool ExploreISASubsets(const int subsetSize, const int minInstructions, const int maxInstructions, const SynthOptions& options)
+{
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+
+	const int setOpCode = ISA_OpCodeForName("set");
+	std::vector<int> otherOpCodes;
+	for (int opcode = 0; opcode < ISA_NumOpCodes(); opcode++)
+	{
+		if (opcode != setOpCode)
+		{
+			otherOpCodes.push_back(opcode);
+		}
+	}
+
+	std::vector<SubsetResult> subsets;
+	const int numOther = static_cast<int>(otherOpCodes.size());
+	for (int mask = 0; mask < (1 << numOther); mask++)
+	{
+		int numBits = 0;
+		for (int i = 0; i < numOther; i++)
+		{
+			numBits += (mask >> i) & 1;
+		}
+
+		if (numBits != subsetSize - 1)
+		{
+			continue;
+		}
+
+		SubsetResult subset;
+		subset.isa.addOpcode(setOpCode);
+		for (int i = 0; i < numOther; i++)
+		{
+			if (mask & (1 << i))
+			{
+				subset.isa.addOpcode(otherOpCodes[i]);
+			}
+		}
+
+		for (int i = 0; i < subset.isa.size(); i++)
+		{
+			subset.name += (i > 0 ? " " : "") + std::string(subset.isa.opName(i));
+		}
+
+		subsets.push_back(std::move(subset));
+	}
+
+	if (subsets.empty())
+	{
+		printf("No subsets of %d opcodes\n", subsetSize);
+		return false;
+	}
+
+	std::mutex mutex;
+	int bestLength = INT_MAX;
+	int bestSubset = -1;
+
+	// must hold the mutex
+	auto interruptLongerJobs = [&]()
+	{
+		for (auto& subset: subsets)
+		{
+			if (subset.runningLength > bestLength && subset.ctx)
+			{
+				subset.ctx->interrupt();
+			}
+		}
+	};
+
+	{
+		ThreadPool pool(options.numThreads);
+		printf("Exploring %d subsets of %d opcodes, lengths %d to %d on %d threads...\n\n", 
+			static_cast<int>(subsets.size()), subsetSize, minInstructions, maxInstructions - 1, pool.size());
+
+		std::function<void(int, int)> runLength = [&](const int subsetIdx, const int numInstr)
+		{
+			SubsetResult& subset = subsets[subsetIdx];
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (numInstr > bestLength)
+				{
+					return;
+				}
+
+				subset.ctx.reset(new z3::context);
+				subset.runningLength = numInstr;
+			}
+
+			std::unique_ptr<CodeGenContext> codeGen;
+			auto res = z3::unknown;
+			try
+			{
+				codeGen.reset(new CodeGenContext(*subset.ctx, numInputs, numInstr, subset.isa, options));
+				codeGen->verbose = false;
+
+				res = SolveLength(*codeGen, numChains);
+				RecordLengthStats(*codeGen, options, res);
+			}
+			catch (z3::exception&)
+			{
+				res = z3::unknown;
+			}
+
+			std::unique_ptr<z3::context> ctx;
+			bool tryNextLength = false;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				subset.totalTimeMs += codeGen ? codeGen->solveTimeMs : 0;
+				subset.runningLength = -1;
+
+				if (res == z3::sat)
+				{
+					subset.satLength = numInstr;
+					subset.satTimeMs = codeGen->solveTimeMs;
+
+					const bool isBest = bestSubset < 0 || numInstr < bestLength || 
+						(numInstr == bestLength && subset.satTimeMs < subsets[bestSubset].satTimeMs);
+					if (isBest)
+					{
+						// only keep the model of the best subset so it can be printed at the end
+						if (bestSubset >= 0 && bestSubset != subsetIdx)
+						{
+							subsets[bestSubset].codeGen.reset();
+							subsets[bestSubset].ctx.reset();
+						}
+
+						bestSubset = subsetIdx;
+						bestLength = numInstr;
+						subset.codeGen = std::move(codeGen);
+						interruptLongerJobs();
+					}
+				}
+
+				tryNextLength = res == z3::unsat && numInstr + 1 < maxInstructions && numInstr + 1 <= bestLength;
+				if (!subset.codeGen)
+				{
+					ctx = std::move(subset.ctx);
+				}
+			}
+
+			codeGen.reset();
+			ctx.reset();
+
+			if (tryNextLength)
+			{
+				pool.submit([&runLength, subsetIdx, numInstr]() { runLength(subsetIdx, numInstr + 1); });
+			}
+		};
+
+		for (int i = 0; i < static_cast<int>(subsets.size()); i++)
+		{
+			pool.submit([&runLength, i, minInstructions]() { runLength(i, minInstructions); });
+		}
+
+		// an interrupt can be missed if it arrives before the job has started solving so keep repeating it 
+		while (!pool.waitFor(std::chrono::milliseconds(10)))
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			interruptLongerJobs();
+		}
+	}
+
+	std::vector<const SubsetResult*> ranked;
+	for (const auto& subset: subsets)
+	{
+		if (subset.satLength > 0)
+		{
+			ranked.push_back(&subset);
+		}
+	}
+
+	std::sort(ranked.begin(), ranked.end(), [](const SubsetResult* a, const SubsetResult* b)
+	{
+		return a->satLength != b->satLength ? a->satLength < b->satLength : a->satTimeMs < b->satTimeMs;
+	});
+
+	printf("Results:\n");
+	printf("  length  solve ms  total ms  opcodes\n");
+	for (const SubsetResult* subset: ranked)
+	{
+		printf("  %6d  %8lld  %8lld  %s\n", subset->satLength, subset->satTimeMs, subset->totalTimeMs, subset->name.c_str());
+	}
+
+	printf("  %d / %d subsets satisfied\n\n", static_cast<int>(ranked.size()), static_cast<int>(subsets.size()));
+
+	if (bestSubset < 0)
+	{
+		return false;
+	}
+
+	SubsetResult& best = subsets[bestSubset];
+	printf("Best subset: %s\n\n", best.name.c_str());
+
+	PrintSolution(*best.codeGen);
+
+	// the codeGen must be destroyed before its context
+	best.codeGen.reset();
+	best.ctx.reset();
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,18 @@
+#ifndef		EXPLORE_H_HAS_BEEN_INCLUDED
+#define		EXPLORE_H_HAS_BEEN_INCLUDED
+
+#include	"codegen.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Search every subset of the full ISA which has subsetSize opcodes and includes "set". Each (subset, length) job is
+// run on the work-stealing thread pool, when a subset's length is unsatisfiable the job for the next length is 
+// submitted from the worker. Once any subset is satisfied longer lengths are skipped for all subsets and the 
+// results are ranked by length and then solve time.
+bool ExploreISASubsets(const int subsetSize, const int minInstructions, const int maxInstructions, const SynthOptions& options);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  EXPLORE_H_HAS_BEEN_INCLUDED
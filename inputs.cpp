@@ -0,0 +1,115 @@
+#include	"inputs.h"
+
+#include	<stdint.h>
+#include	<algorithm>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static void AddUnique(std::vector<ValueType>& values, const ValueType v)
+{
+	if (std::find(values.begin(), values.end(), v) == values.end())
+	{
+		values.push_back(v);
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+std::vector<ValueType> BoundaryInputs(const int bitWidth)
+{
+	const uint32_t signBit = 1u << (std::min(bitWidth, 32) - 1);
+	const ValueType minValue = NarrowValue(bitWidth, static_cast<ValueType>(signBit));
+	const ValueType maxValue = NarrowValue(bitWidth, static_cast<ValueType>(signBit - 1));
+
+	std::vector<ValueType> values;
+	const ValueType small[] = { 0, 1, -1, minValue, maxValue, minValue + 1, maxValue - 1, 2, -2 };
+	for (const ValueType v: small)
+	{
+		AddUnique(values, NarrowValue(bitWidth, v));
+	}
+
+	for (int bit = 2; bit < bitWidth; bit++)
+	{
+		const uint32_t power = 1u << bit;
+		AddUnique(values, NarrowValue(bitWidth, static_cast<ValueType>(power)));
+		AddUnique(values, NarrowValue(bitWidth, static_cast<ValueType>(power - 1)));
+		AddUnique(values, NarrowValue(bitWidth, -static_cast<ValueType>(power)));
+	}
+
+	const uint32_t patterns[] = { 0x55555555u, 0xaaaaaaaau, 0x33333333u, 0xccccccccu, 0x0f0f0f0fu, 0xf0f0f0f0u, 0x00ff00ffu, 0xff00ff00u };
+	for (const uint32_t pattern: patterns)
+	{
+		AddUnique(values, NarrowValue(bitWidth, static_cast<ValueType>(pattern)));
+	}
+
+	return values;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+std::vector<ValueType> TargetChangePoints(TargetFn target, const int bitWidth)
+{
+	auto f = [&](const int64_t x) { return NarrowValue(bitWidth, target(NarrowValue(bitWidth, static_cast<ValueType>(x)))); };
+	auto slope = [&](const int64_t x) { return static_cast<uint32_t>(f(x + 1)) - static_cast<uint32_t>(f(x)); };
+
+	// the samples are kept as 64 bit values so the bisection can't wrap around
+	std::vector<int64_t> samples;
+	for (const ValueType v: BoundaryInputs(bitWidth))
+	{
+		samples.push_back(v);
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	std::vector<ValueType> points;
+	for (size_t i = 0; i + 1 < samples.size(); i++)
+	{
+		int64_t lo = samples[i];
+		int64_t hi = samples[i + 1];
+		const uint32_t loSlope = slope(lo);
+		if (loSlope == slope(hi))
+		{
+			continue;
+		}
+
+		// slope(lo) == loSlope and slope(hi) differs, find the last x where the slope is still loSlope
+		while (hi - lo > 1)
+		{
+			const int64_t mid = lo + (hi - lo) / 2;
+			if (slope(mid) == loSlope)
+			{
+				lo = mid;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+
+		AddUnique(points, NarrowValue(bitWidth, static_cast<ValueType>(lo)));
+		AddUnique(points, NarrowValue(bitWidth, static_cast<ValueType>(lo + 1)));
+		AddUnique(points, NarrowValue(bitWidth, static_cast<ValueType>(lo + 2)));
+	}
+
+	return points;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+std::vector<ValueType> InterestingInputs(TargetFn target, const int bitWidth)
+{
+	std::vector<ValueType> values = TargetChangePoints(target, bitWidth);
+	for (const ValueType v: BoundaryInputs(bitWidth))
+	{
+		AddUnique(values, v);
+	}
+
+	return values;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,28 @@
+#ifndef		INPUTS_H_HAS_BEEN_INCLUDED
+#define		INPUTS_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+
+#include	"isa.h"
+#include	"program.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Values which wrong programs tend to get wrong: 0, +-1, the extremes of the range, the powers of two and their
+// neighbours and repeating bit patterns, sign extended to bitWidth bits with the duplicates removed
+std::vector<ValueType> BoundaryInputs(const int bitWidth);
+
+// Inputs either side of the points where the target's behaviour changes, e.g. 0 and -1 for abs. The range is
+// sampled at the boundary inputs and each pair of neighbouring samples where the slope of the target (f(x + 1) - f(x))
+// differs is bisected down to the point where it changes.
+std::vector<ValueType> TargetChangePoints(TargetFn target, const int bitWidth);
+
+// The change points followed by the boundary inputs, the most useful first. The values don't depend on anything
+// random so the chains they seed are the same on every run.
+std::vector<ValueType> InterestingInputs(TargetFn target, const int bitWidth);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  INPUTS_H_HAS_BEEN_INCLUDED
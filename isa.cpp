@@ -5,113 +5,54 @@ using namespace z3;
 // ====================================================================================================================
 // ====================================================================================================================
 
-void fmt_reg_reg(const int opcodeIdx, const int instrIdx, const EvalOperands& opers)
+static constexpr Instruction ISA[] =
 {
-	printf("  r%d = %s r%d r%d\n", instrIdx, ISA_OpName(opcodeIdx), opers.x, opers.y);
-}
-
-void fmt_reg_imm(const int opcodeIdx, const int instrIdx, const EvalOperands& opers)
-{
-	printf("  r%d = %s r%d 0x%x\n", instrIdx, ISA_OpName(opcodeIdx), opers.x, opers.imm32);
-}
+#define ISA_OP_ROW(name, format, arity, latency, rthroughput, kind, semantics) \
+	Instruction( #name, Instruction::format, arity, latency, rthroughput, Instruction::kind, #semantics ),
+	ISA_OPS(ISA_OP_ROW)
+#undef ISA_OP_ROW
+};
 
-void fmt_imm(const int opcodeIdx, const int instrIdx, const EvalOperands& opers)
-{
-	printf("  r%d = %s 0x%x\n", instrIdx, ISA_OpName(opcodeIdx), opers.imm32);
-}
+static_assert(sizeof(ISA) / sizeof(ISA[0]) == OpCode_Count, "the ISA table must have a row for each opcode");
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-expr sim_set(SimOperands& opers) { return opers.imm32; }
-
-expr sim_add(SimOperands& opers) { return opers.x + opers.y; }
-expr sim_sub(SimOperands& opers) { return opers.x - opers.y; }
-expr sim_mul(SimOperands& opers) { return opers.x * opers.y; }
-
-expr sim_xor(SimOperands& opers) { return opers.x ^ opers.y; }
-expr sim_and(SimOperands& opers) { return opers.x & opers.y; }
-expr sim_or (SimOperands& opers) { return opers.x | opers.y; }
-
-expr sim_xor_not(SimOperands& opers) { return opers.x ^ (~opers.y); }
-expr sim_and_not(SimOperands& opers) { return opers.x & ~opers.y; }
-expr sim_or_not (SimOperands& opers) { return opers.x | ~opers.y; }
-
-expr sim_shl(SimOperands& opers) { return to_expr(opers.ctx, Z3_mk_bvshl(opers.ctx, opers.x, opers.imm32)); }
-expr sim_shr(SimOperands& opers) { return to_expr(opers.ctx, Z3_mk_bvashr(opers.ctx, opers.x, opers.imm32)); }
-
-expr sim_gt(SimOperands& opers) 
-{ 
-	// a more complicated/powerful instruction: return either ~0 or 0 as the result of a comparison
-	// "ite" is if-then-else: if the comparison is true return ~0 else 0
-	return ite(opers.x > opers.y, opers.ctx.bv_val(0xffffffff, 32), opers.ctx.bv_val(0, 32));
+int ISA_NumOpCodes()
+{
+	return sizeof(ISA) / sizeof(ISA[0]);
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-ValueType eval_set(const EvalOperands& opers) { return opers.imm32; }
-
-ValueType eval_add(const EvalOperands& opers) { return opers.x + opers.y; }
-ValueType eval_sub(const EvalOperands& opers) { return opers.x - opers.y; }
-ValueType eval_mul(const EvalOperands& opers) { return opers.x * opers.y; }
-
-ValueType eval_xor(const EvalOperands& opers) { return opers.x ^ opers.y; }
-ValueType eval_and(const EvalOperands& opers) { return opers.x & opers.y; }
-ValueType eval_or (const EvalOperands& opers) { return opers.x | opers.y; }
-
-ValueType eval_xor_not(const EvalOperands& opers) { return opers.x ^ (~opers.y); }
-ValueType eval_and_not(const EvalOperands& opers) { return opers.x & ~opers.y; }
-ValueType eval_or_not (const EvalOperands& opers) { return opers.x | ~opers.y; }
-
-ValueType eval_shl(const EvalOperands& opers) { return opers.x << opers.imm32; }
-ValueType eval_shr(const EvalOperands& opers) { return opers.x >> opers.imm32; }
-
-// the C version is much simpler!
-ValueType eval_gt(const EvalOperands& opers) { return opers.x > opers.y ? 0xffffffff : 0; }
+const char* ISA_OpName(const int opCode)
+{
+	return ISA[opCode].name_;
+}
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-static const Instruction ISA[] =
+int ISA_OpArity(const int opCode)
 {
-	// rather than having multiple versions of each opcode with different operands
-	// a single opcode is implemented to allow an immediate value to be introduced
-	// into the instruction stream (this signficantly reduces the search space)
-	Instruction( "set", fmt_imm, sim_set, eval_set ),
-
-	Instruction( "add", fmt_reg_reg, sim_add, eval_add ),
-	Instruction( "sub", fmt_reg_reg, sim_sub, eval_sub ),
-	Instruction( "mul", fmt_reg_reg, sim_mul, eval_mul ),
-
-	Instruction( "xor", fmt_reg_reg, sim_xor, eval_xor ),
-	Instruction( "and", fmt_reg_reg, sim_and, eval_and ),
-	Instruction( "or" , fmt_reg_reg, sim_or,  eval_or ),
-
-	Instruction( "xor_not", fmt_reg_reg, sim_xor_not, eval_xor_not ),
-	Instruction( "and_not", fmt_reg_reg, sim_and_not, eval_and_not ),
-	Instruction( "or_not" , fmt_reg_reg, sim_or_not,  eval_or_not ),
-
-	Instruction( "shl", fmt_reg_imm, sim_shl, eval_shl, Instruction::Kind_Shift ),
-	Instruction( "shr", fmt_reg_imm, sim_shr, eval_shr, Instruction::Kind_Shift ),
-
-	Instruction( "gt", fmt_reg_reg, sim_gt, eval_gt ),
-};
+	return ISA[opCode].arity;
+}
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-int ISA_NumOpCodes()
+int ISA_OpLatency(const int opCode)
 {
-	return sizeof(ISA) / sizeof(ISA[0]);
+	return ISA[opCode].latency;
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-const char* ISA_OpName(const int opCode)
+float ISA_OpThroughput(const int opCode)
 {
-	return ISA[opCode].name_;
+	return ISA[opCode].rthroughput;
 }
 
 // ====================================================================================================================
@@ -136,25 +77,79 @@ int ISA_OpCodeForName(const char* name)
 // ====================================================================================================================
 // ====================================================================================================================
 
-void ISA_FormatOp(const int opcodeIdx, const int instrIdx, const EvalOperands& operands)
+void ISA_FormatOp(const int opcodeIdx, const int instrIdx, const int regX, const int regY, const ValueType imm32)
 {
-	ISA[opcodeIdx].fmt_(opcodeIdx, instrIdx, operands);
+	switch (ISA[opcodeIdx].format)
+	{
+		case Instruction::Format_Imm:
+			printf("  r%d = %s 0x%x\n", instrIdx, ISA_OpName(opcodeIdx), imm32);
+			break;
+
+		case Instruction::Format_RegReg:
+			printf("  r%d = %s r%d r%d\n", instrIdx, ISA_OpName(opcodeIdx), regX, regY);
+			break;
+
+		case Instruction::Format_RegImm:
+			printf("  r%d = %s r%d 0x%x\n", instrIdx, ISA_OpName(opcodeIdx), regX, imm32);
+			break;
+	}
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-z3::expr ISA_SimulateOp(const int opcodeIdx, SimOperands& operands)
+bool ISA_OpUsesImm(const int opCode)
 {
-	return ISA[opcodeIdx].sim_(operands);
+	return ISA[opCode].format != Instruction::Format_RegReg;
 }
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-ValueType ISA_EvaluateOp(const int opcodeIdx, const EvalOperands& operands)
+void ISA_WriteCOps(FILE* file)
 {
-	return ISA[opcodeIdx].eval_(operands);
+	fprintf(file, "static inline int32_t Add(int32_t x, int32_t y) { return (int32_t)((uint32_t)x + (uint32_t)y); }\n");
+	fprintf(file, "static inline int32_t Sub(int32_t x, int32_t y) { return (int32_t)((uint32_t)x - (uint32_t)y); }\n");
+	fprintf(file, "static inline int32_t Mul(int32_t x, int32_t y) { return (int32_t)((uint32_t)x * (uint32_t)y); }\n");
+	fprintf(file, "static inline int32_t ShiftLeft(int32_t x, int32_t n) { return (int32_t)((uint32_t)x << n); }\n");
+	fprintf(file, "static inline int32_t ShiftRight(int32_t x, int32_t n) { return x >> n; }\n");
+	fprintf(file, "static inline int32_t GreaterMask(int32_t x, int32_t y) { return -(int32_t)(x > y); }\n\n");
+
+	for (int i = 0; i < ISA_NumOpCodes(); i++)
+	{
+		fprintf(file, "static inline int32_t op_%s(int32_t x, int32_t y, int32_t imm) { (void)x; (void)y; (void)imm; return %s; }\n", 
+			ISA[i].name_, ISA[i].source);
+	}
+
+	fprintf(file, "\n");
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void ISA_FormatOpC(FILE* file, const int opcodeIdx, const int instrIdx, const int regX, const int regY, const ValueType imm32)
+{
+	fprintf(file, "\tconst int32_t r%d = op_%s(r%d, r%d, (int32_t)0x%x);\n", instrIdx, ISA_OpName(opcodeIdx), regX, regY, imm32);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The same semantics as ISA_Evaluate with the operands as bit-vector expressions of the encoding's width
+z3::expr ISA_SimulateOp(const int opcodeIdx, SimOperands& operands)
+{
+	const z3::expr& x = operands.x;
+	const z3::expr& y = operands.y;
+	const z3::expr& imm = operands.imm32;
+
+	switch (opcodeIdx)
+	{
+#define ISA_OP_SIM(name, format, arity, latency, rthroughput, kind, semantics) case OpCode_##name: return semantics;
+		ISA_OPS(ISA_OP_SIM)
+#undef ISA_OP_SIM
+	}
+
+	return imm;
 }
 
 // ====================================================================================================================
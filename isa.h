@@ -2,8 +2,10 @@
 #define		ISA_H_HAS_BEEN_INCLUDED
 
 #include	<vector>
+#include	<type_traits>
 #include	<z3++.h>
 #include	<string.h>
+#include	<stdio.h>
 
 // ====================================================================================================================
 // ====================================================================================================================
@@ -11,6 +13,8 @@
 // ====================================================================================================================
 // ====================================================================================================================
 
+// The register type of the programs, the search, Program, the cache and the verification are all written for it. 
+// Only the ISA semantics and the native evaluators below are generic over the integer type.
 using ValueType = int32_t;
 //using ValueType = uint32_t;
 
@@ -36,46 +40,218 @@ struct Operands
 };
 
 using SimOperands = Operands<z3::expr>;
-using EvalOperands = Operands<ValueType>;
 
 // ====================================================================================================================
 // ====================================================================================================================
 
-#include <functional>
-using FmtFn = std::function<void(const int, const int, const EvalOperands&)>;
-using EvalFn = std::function<ValueType(const EvalOperands&)>;
-using SimFn = std::function<z3::expr(SimOperands&)>;
+// The few operations which are written differently for the solver and for native values (where signed overflow 
+// would be undefined, so the arithmetic is done unsigned). Each op's semantics is 
+// written once in terms of these and the C++ operators, and instantiated for z3::expr and any native integer type.
+
+inline z3::expr Add(const z3::expr& x, const z3::expr& y) 
+{ 
+	return x + y; 
+}
+
+inline z3::expr Sub(const z3::expr& x, const z3::expr& y) 
+{ 
+	return x - y; 
+}
+
+inline z3::expr Mul(const z3::expr& x, const z3::expr& y) 
+{ 
+	return x * y; 
+}
+
+inline z3::expr ShiftLeft(const z3::expr& x, const z3::expr& n) 
+{ 
+	return z3::to_expr(x.ctx(), Z3_mk_bvshl(x.ctx(), x, n)); 
+}
+
+inline z3::expr ShiftRight(const z3::expr& x, const z3::expr& n) 
+{ 
+	return z3::to_expr(x.ctx(), Z3_mk_bvashr(x.ctx(), x, n)); 
+}
+
+// ~0 if x > y (signed) else 0
+inline z3::expr GreaterMask(const z3::expr& x, const z3::expr& y) 
+{ 
+	const unsigned bitWidth = x.get_sort().bv_size();
+	return z3::ite(x > y, x.ctx().bv_val(-1, bitWidth), x.ctx().bv_val(0, bitWidth));
+}
+
+// The unsigned type the native arithmetic is done in, at least as wide as unsigned int so the narrow types aren't
+// promoted back to int (where e.g. 0xffff * 0xffff would still overflow)
+template <typename T>
+using WrapType = typename std::common_type<typename std::make_unsigned<T>::type, unsigned>::type;
+
+template <typename T>
+inline T Add(const T x, const T y) 
+{ 
+	return static_cast<T>(static_cast<WrapType<T>>(x) + static_cast<WrapType<T>>(y)); 
+}
+
+template <typename T>
+inline T Sub(const T x, const T y) 
+{ 
+	return static_cast<T>(static_cast<WrapType<T>>(x) - static_cast<WrapType<T>>(y)); 
+}
+
+template <typename T>
+inline T Mul(const T x, const T y) 
+{ 
+	return static_cast<T>(static_cast<WrapType<T>>(x) * static_cast<WrapType<T>>(y)); 
+}
+
+// shifted as unsigned so shifting a negative value left is well defined
+template <typename T>
+inline T ShiftLeft(const T x, const T n) 
+{ 
+	return static_cast<T>(static_cast<WrapType<T>>(x) << n); 
+}
+
+template <typename T>
+inline T ShiftRight(const T x, const T n) 
+{ 
+	return x >> n; 
+}
+
+// written as a mask rather than a branch so the batch loops vectorize to a compare
+template <typename T>
+inline T GreaterMask(const T x, const T y) 
+{ 
+	return static_cast<T>(-static_cast<T>(x > y)); 
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The whole ISA, one line per op: name, print format, arity, latency, reciprocal throughput, kind and semantics as an
+// expression over x, y and imm. The arity is the number of register operands the instruction reads, 0 only uses imm 
+// and 1 only uses x. The latency and reciprocal throughput are in cycles for scalar x86 (Skylake), xor_not and or_not
+// need a not and gt is cmp + setg + neg.
+//
+// Rather than having multiple versions of each opcode with different operands a single opcode is implemented to 
+// allow an immediate value to be introduced into the instruction stream (this signficantly reduces the search space)
+#define ISA_OPS(OP) \
+	OP( set,     Format_Imm,    0, 1, 0.25f, Kind_None,           imm ) \
+	OP( add,     Format_RegReg, 2, 1, 0.25f, Kind_Commutative,    Add(x, y) ) \
+	OP( sub,     Format_RegReg, 2, 1, 0.25f, Kind_None,           Sub(x, y) ) \
+	OP( mul,     Format_RegReg, 2, 3, 1.f,   Kind_Commutative,    Mul(x, y) ) \
+	OP( xor,     Format_RegReg, 2, 1, 0.25f, Kind_Commutative,    x ^ y ) \
+	OP( and,     Format_RegReg, 2, 1, 0.25f, Kind_Commutative,    x & y ) \
+	OP( or,      Format_RegReg, 2, 1, 0.25f, Kind_Commutative,    x | y ) \
+	OP( xor_not, Format_RegReg, 2, 2, 0.5f,  Kind_Commutative,    x ^ ~y ) \
+	OP( and_not, Format_RegReg, 2, 1, 0.5f,  Kind_None,           x & ~y ) \
+	OP( or_not,  Format_RegReg, 2, 2, 0.5f,  Kind_None,           x | ~y ) \
+	OP( shl,     Format_RegImm, 1, 1, 0.5f,  Kind_Shift,          ShiftLeft(x, imm) ) \
+	OP( shr,     Format_RegImm, 1, 1, 0.5f,  Kind_Shift,          ShiftRight(x, imm) ) \
+	OP( gt,      Format_RegReg, 2, 3, 1.f,   Kind_None,           GreaterMask(x, y) )
+
+enum ISAOpCode
+{
+#define ISA_OP_ENUM(name, format, arity, latency, rthroughput, kind, semantics) OpCode_##name,
+	ISA_OPS(ISA_OP_ENUM)
+#undef ISA_OP_ENUM
+	OpCode_Count
+};
 
 struct Instruction
 {
 	const static int Kind_None          = 0;
 	const static int Kind_Shift         = 1 << 0;
+	const static int Kind_Commutative   = 1 << 1;
 
-	Instruction(const char* name, FmtFn fmt, SimFn sim, EvalFn eval, const int _kindMask = Kind_None)
+	enum Format
+	{
+		Format_Imm,         // r = op imm
+		Format_RegReg,      // r = op x y
+		Format_RegImm,      // r = op x imm
+	};
+
+	constexpr Instruction(const char* name, const Format _format, const int _arity, const int _latency, 
+		const float _rthroughput, const int _kindMask, const char* _source)
 		: name_(name)
+		, format(_format)
 		, kindMask(_kindMask)
-		, fmt_(fmt)
-		, sim_(sim)
-		, eval_(eval)
+		, arity(_arity)
+		, latency(_latency)
+		, rthroughput(_rthroughput)
+		, source(_source)
 	{
 	}
 
-	const char* name_ = nullptr;
-	int kindMask = Kind_None;
-	FmtFn fmt_ = nullptr;
-	SimFn sim_ = nullptr;
-	EvalFn eval_ = nullptr;
+	const char* name_;
+	Format format;
+	int kindMask;
+	int arity;
+	int latency;
+	float rthroughput;
+
+	// the semantics as written in ISA_OPS, it is also valid C given the helpers ISA_WriteCOps writes
+	const char* source;
 };
 
 // ====================================================================================================================
 // ====================================================================================================================
 
+// Evaluate an op natively for any integer width, a switch rather than an indirect call so it can be inlined into the
+// evaluation loops
+template <typename T>
+inline T ISA_Evaluate(const int opcodeIdx, const T x, const T y, const T imm)
+{
+	switch (opcodeIdx)
+	{
+#define ISA_OP_EVAL(name, format, arity, latency, rthroughput, kind, semantics) case OpCode_##name: return static_cast<T>(semantics);
+		ISA_OPS(ISA_OP_EVAL)
+#undef ISA_OP_EVAL
+	}
+
+	return 0;
+}
+
+// Evaluate an op for count sets of operands at once. The op is only looked up once and each case is a plain loop over
+// the arrays so the compiler can vectorize it.
+template <typename T>
+inline void ISA_EvaluateBatch(const int opcodeIdx, const T* xs, const T* ys, const T imm, T* out, const int count)
+{
+	switch (opcodeIdx)
+	{
+#define ISA_OP_EVAL_BATCH(name, format, arity, latency, rthroughput, kind, semantics) \
+		case OpCode_##name: \
+			for (int i = 0; i < count; i++) \
+			{ \
+				const T x = xs[i]; \
+				const T y = ys[i]; \
+				(void)x; (void)y; \
+				out[i] = static_cast<T>(semantics); \
+			} \
+			break;
+		ISA_OPS(ISA_OP_EVAL_BATCH)
+#undef ISA_OP_EVAL_BATCH
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// ====================================================================================================================
+// ====================================================================================================================
+
 int ISA_NumOpCodes();
 const char* ISA_OpName(const int opCode);
+int ISA_OpArity(const int opCode);
+int ISA_OpLatency(const int opCode);
+float ISA_OpThroughput(const int opCode);
 int ISA_OpCodeForName(const char* name);
-void ISA_FormatOp(const int opcodeIdx, const int instrIdx, const EvalOperands& operands); 
+bool ISA_OpUsesImm(const int opCode);
+void ISA_FormatOp(const int opcodeIdx, const int instrIdx, const int regX, const int regY, const ValueType imm32); 
+
+// Write the ops as C: ISA_WriteCOps writes a static inline function op_<name>(x, y, imm) for each op and the helpers
+// they use, ISA_FormatOpC writes an instruction as a call to one. The C has to be compiled with -fwrapv.
+void ISA_WriteCOps(FILE* file);
+void ISA_FormatOpC(FILE* file, const int opcodeIdx, const int instrIdx, const int regX, const int regY, const ValueType imm32); 
 z3::expr ISA_SimulateOp(const int opcodeIdx, SimOperands& operands);
-ValueType ISA_EvaluateOp(const int opcodeIdx, const EvalOperands& operands);
 std::vector<int> ISA_OpCodesForKindMask(const int kindMask);
 
 // ====================================================================================================================
@@ -91,11 +267,21 @@ public:
 		instOpcodes_.push_back(opcode);
 	}
 
+	int isaOpCode(const int localID) const
+	{
+		return instOpcodes_[localID];
+	}
+
 	const char* opName(const int localID)
 	{
 		return ISA_OpName(instOpcodes_[localID]);
 	}
 
+	int opArity(const int localID)
+	{
+		return ISA_OpArity(instOpcodes_[localID]);
+	}
+
 	int opCodeForName(const char* name)
 	{
 		for (int i = 0; i < instOpcodes_.size(); i++)
@@ -109,21 +295,11 @@ public:
 		return -1;
 	}
 
-	void formatOp(const int localID, const int instrIdx, const EvalOperands& operands)
-	{
-		return ISA_FormatOp(instOpcodes_[localID], instrIdx, operands);
-	}
-
 	z3::expr simulateOp(const int localID, SimOperands& operands)
 	{
 		return ISA_SimulateOp(instOpcodes_[localID], operands);
 	}
 
-	ValueType evaluateOp(const int localID, const EvalOperands& operands)
-	{
-		return ISA_EvaluateOp(instOpcodes_[localID], operands);
-	}
-
 	std::vector<int> opCodesForKindMask(const int kindMask)
 	{
 		std::vector<int> localIDs;
@@ -0,0 +1,43 @@
+#ifndef		JSON_H_HAS_BEEN_INCLUDED
+#define		JSON_H_HAS_BEEN_INCLUDED
+
+#include	<stdio.h>
+#include	<string>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Quote and escape a string for writing into JSON output
+inline std::string JsonString(const std::string& s)
+{
+	std::string out = "\"";
+	for (const char c: s)
+	{
+		switch (c)
+		{
+		case '"':       out += "\\\""; break;
+		case '\\':      out += "\\\\"; break;
+		case '\n':      out += "\\n"; break;
+		case '\t':      out += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				sprintf(escaped, "\\u%04x", c);
+				out += escaped;
+			}
+			else
+			{
+				out += c;
+			}
+			break;
+		}
+	}
+
+	return out + "\"";
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  JSON_H_HAS_BEEN_INCLUDED
@@ -0,0 +1,175 @@
+#include	"portfolio.h"
+
+#include	<stdio.h>
+#include	<climits>
+#include	<chrono>
+#include	<memory>
+#include	<mutex>
+#include	<condition_variable>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct PortfolioJob
+{
+	int                                 numInstr = 0;
+	std::unique_ptr<z3::context>        ctx;
+	std::unique_ptr<CodeGenContext>     codeGen;
+	z3::check_result                    res = z3::unknown;
+	long long                           solveTimeMs = 0;
+	bool                                finished = false;
+	bool                                cancelled = false;
+	std::string                         error;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool FindSolutionPortfolio(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options)
+{
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+
+	std::vector<PortfolioJob> jobs(maxInstructions - minInstructions);
+	std::mutex mutex;
+	std::condition_variable jobFinished;
+	int bestLength = INT_MAX;
+
+	// must hold the mutex
+	auto interruptLongerJobs = [&]()
+	{
+		for (auto& job: jobs)
+		{
+			if (job.numInstr > bestLength && !job.finished && job.ctx)
+			{
+				job.ctx->interrupt();
+			}
+		}
+	};
+
+	{
+		ThreadPool pool(options.numThreads);
+		printf("Running lengths %d to %d on %d threads...\n", minInstructions, maxInstructions - 1, pool.size());
+
+		for (int i = 0; i < static_cast<int>(jobs.size()); i++)
+		{
+			jobs[i].numInstr = minInstructions + i;
+			pool.submit([&, i]()
+			{
+				PortfolioJob& job = jobs[i];
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (job.numInstr > bestLength)
+					{
+						job.cancelled = true;
+						job.finished = true;
+						jobFinished.notify_all();
+						return;
+					}
+
+					job.ctx.reset(new z3::context);
+				}
+
+				auto res = z3::unknown;
+				try
+				{
+					job.codeGen.reset(new CodeGenContext(*job.ctx, numInputs, job.numInstr, isa, options));
+					job.codeGen->verbose = false;
+
+					res = SolveLength(*job.codeGen, numChains);
+					job.solveTimeMs = job.codeGen->solveTimeMs;
+					RecordLengthStats(*job.codeGen, options, res);
+				}
+				catch (z3::exception& e)
+				{
+					job.error = e.msg();
+				}
+
+				// declared in this order so the codeGen is destroyed before its context
+				std::unique_ptr<z3::context> ctx;
+				std::unique_ptr<CodeGenContext> codeGen;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					job.res = res;
+					job.finished = true;
+					job.cancelled = res == z3::unknown && job.numInstr > bestLength;
+
+					if (res == z3::sat && job.numInstr < bestLength)
+					{
+						bestLength = job.numInstr;
+						interruptLongerJobs();
+					}
+					else
+					{
+						// only the satisfied models need to be kept around to be printed
+						codeGen = std::move(job.codeGen);
+						ctx = std::move(job.ctx);
+					}
+				}
+
+				jobFinished.notify_all();
+			});
+		}
+
+		// an interrupt can be missed if it arrives before the job has started solving so keep repeating it 
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			bool allFinished = true;
+			for (const auto& job: jobs)
+			{
+				allFinished = allFinished && job.finished;
+			}
+
+			if (allFinished)
+			{
+				break;
+			}
+
+			jobFinished.wait_for(lock, std::chrono::milliseconds(10));
+			interruptLongerJobs();
+		}
+	}
+
+	for (auto& job: jobs)
+	{
+		printf("Try with %d instructions...\n", job.numInstr);
+		if (job.cancelled)
+		{
+			printf("  cancelled\n");
+			continue;
+		}
+
+		if (!job.error.empty())
+		{
+			printf("  %s\n", job.error.c_str());
+			continue;
+		}
+
+		printf("  solver.check() call completed: %lld ms\n", job.solveTimeMs);
+		if (job.res != z3::sat)
+		{
+			printf(job.res == z3::unsat ? "  unsatifiable\n" : "  unknown\n");
+			continue;
+		}
+
+		if (job.numInstr != bestLength)
+		{
+			continue;
+		}
+
+		CodeGenContext& codeGen = *job.codeGen;
+		printf("  satisified! (%d chains)\n\n", codeGen.numChains);
+
+		PrintSolution(codeGen);
+
+		return true;
+	}
+
+	return false;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
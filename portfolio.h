@@ -0,0 +1,17 @@
+#ifndef		PORTFOLIO_H_HAS_BEEN_INCLUDED
+#define		PORTFOLIO_H_HAS_BEEN_INCLUDED
+
+#include	"codegen.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Run FindSolution for all the lengths in [minInstructions, maxInstructions) at once, each length has its own context
+// and is run on the thread pool. When length k is satisfied all the jobs for lengths > k are cancelled via 
+// context::interrupt but the jobs for lengths < k still run to completion so the shortest program is reported.
+bool FindSolutionPortfolio(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  PORTFOLIO_H_HAS_BEEN_INCLUDED
@@ -0,0 +1,177 @@
+#include	"program.h"
+
+#include	<algorithm>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+const int Program::MAX_INSTRUCTIONS;
+const int Program::BATCH_SIZE;
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void Program::resize(const int numInstr)
+{
+	if (numInstr > MAX_INSTRUCTIONS)
+	{
+		printf("Program too long: %d instructions (max %d)\n", numInstr, MAX_INSTRUCTIONS);
+		exit(1);
+	}
+
+	opcode.resize(numInstr, -1);
+	regX.resize(numInstr, 0);
+	regY.resize(numInstr, 0);
+	imm.resize(numInstr, 0);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+ValueType Program::evaluate(const ValueType* inputs) const
+{
+	ValueType regs[MAX_INSTRUCTIONS];
+	for (int i = 0; i < numInputs; i++)
+	{
+		regs[i] = NarrowValue(bitWidth, inputs[i]);
+	}
+
+	for (int i = numInputs; i < size(); i++)
+	{
+		regs[i] = NarrowValue(bitWidth, ISA_Evaluate(opcode[i], regs[regX[i]], regs[regY[i]], imm[i]));
+	}
+
+	return regs[size() - 1];
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void Program::evaluateBatch(const ValueType* inputs, ValueType* outputs, const int count) const
+{
+	// evaluated one instruction at a time across a block of inputs so the op lookup is only done once per block
+	static thread_local ValueType regs[MAX_INSTRUCTIONS][BATCH_SIZE];
+
+	for (int base = 0; base < count; base += BATCH_SIZE)
+	{
+		const int n = std::min(BATCH_SIZE, count - base);
+
+		for (int i = 0; i < numInputs; i++)
+		{
+			const ValueType* in = inputs + i * count + base;
+			if (bitWidth < 32)
+			{
+				for (int j = 0; j < n; j++)
+				{
+					regs[i][j] = NarrowValue(bitWidth, in[j]);
+				}
+			}
+			else
+			{
+				std::copy(in, in + n, regs[i]);
+			}
+		}
+
+		for (int i = numInputs; i < size(); i++)
+		{
+			ISA_EvaluateBatch(opcode[i], regs[regX[i]], regs[regY[i]], imm[i], regs[i], n);
+			if (bitWidth < 32)
+			{
+				for (int j = 0; j < n; j++)
+				{
+					regs[i][j] = NarrowValue(bitWidth, regs[i][j]);
+				}
+			}
+		}
+
+		std::copy(regs[size() - 1], regs[size() - 1] + n, outputs + base);
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+int Program::latency() const
+{
+	int depth[MAX_INSTRUCTIONS] = {};
+	for (int i = numInputs; i < size(); i++)
+	{
+		const int arity = ISA_OpArity(opcode[i]);
+		const int ready = std::max(arity >= 1 ? depth[regX[i]] : 0, arity >= 2 ? depth[regY[i]] : 0);
+		depth[i] = ready + ISA_OpLatency(opcode[i]);
+	}
+
+	return depth[size() - 1];
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+float Program::throughputCost() const
+{
+	float cost = 0.f;
+	for (int i = numInputs; i < size(); i++)
+	{
+		cost += ISA_OpThroughput(opcode[i]);
+	}
+
+	return cost;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void Program::print() const
+{
+	printf("Generated code:\n");
+
+	for (int i = 0; i < numInputs; i++)
+	{
+		printf("  r%d = <input>\n", i);
+	}
+
+	for (int i = numInputs; i < size(); i++)
+	{
+		ISA_FormatOp(opcode[i], i, regX[i], regY[i], imm[i]);
+	}
+
+	printf("\n");
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void Program::printJson(FILE* file) const
+{
+	fprintf(file, "[");
+	for (int i = numInputs; i < size(); i++)
+	{
+		fprintf(file, "%s{ \"op\": \"%s\", \"x\": %d, \"y\": %d, \"imm\": %d }", 
+			i > numInputs ? ", " : "", ISA_OpName(opcode[i]), regX[i], regY[i], imm[i]);
+	}
+
+	fprintf(file, "]");
+}
+
+void Program::printC(FILE* file, const char* name) const
+{
+	fprintf(file, "static int32_t %s(", name);
+	for (int i = 0; i < numInputs; i++)
+	{
+		fprintf(file, "%sconst int32_t r%d", i > 0 ? ", " : "", i);
+	}
+
+	fprintf(file, ")\n{\n");
+	for (int i = numInputs; i < size(); i++)
+	{
+		ISA_FormatOpC(file, opcode[i], i, regX[i], regY[i], imm[i]);
+	}
+
+	fprintf(file, "\treturn r%d;\n}\n\n", size() - 1);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,86 @@
+#ifndef		PROGRAM_H_HAS_BEEN_INCLUDED
+#define		PROGRAM_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+#include	<functional>
+
+#include	"isa.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The function the generated program has to match, the builtin targets are plain functions and targets read from a
+// spec file are parsed expressions or tables
+using TargetFn = std::function<ValueType(const ValueType)>;
+
+// The same function as a solver expression over a symbolic input, used to state the specification for all inputs at
+// once. Only targets written as expressions have one, native code and I/O tables can't be converted.
+using SimTargetFn = std::function<z3::expr(const z3::expr&)>;
+
+// Sign extend the low bitWidth bits of a value, i.e. the value a bitWidth register would hold
+template <typename T>
+inline T NarrowValue(const int bitWidth, const T v)
+{
+	using U = typename std::make_unsigned<T>::type;
+	if (bitWidth >= static_cast<int>(sizeof(T) * 8))
+	{
+		return v;
+	}
+
+	const U mask = static_cast<U>((U(1) << bitWidth) - 1);
+	const U sign = static_cast<U>(U(1) << (bitWidth - 1));
+	return static_cast<T>(static_cast<U>((static_cast<U>(v) & mask) ^ sign) - sign);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A straight line program decoded from a solver model. The instructions are stored as flat arrays of ISA[] opcodes,
+// operand registers and immediates so the program can be evaluated without going back to the solver. Registers 
+// 0 -> (numInputs - 1) hold the inputs and register i holds the result of instruction i.
+struct Program
+{
+	const static int MAX_INSTRUCTIONS = 64;
+	const static int BATCH_SIZE = 256;
+
+	int                     numInputs = 1;
+	int                     bitWidth = 32;
+
+	std::vector<int>        opcode;
+	std::vector<int>        regX;
+	std::vector<int>        regY;
+	std::vector<ValueType>  imm;
+
+	void resize(const int numInstr);
+
+	int size() const 
+	{ 
+		return static_cast<int>(opcode.size()); 
+	}
+
+	// Returns the value of the last register
+	ValueType evaluate(const ValueType* inputs) const;
+
+	// Evaluate the program for count sets of inputs, input i of set n is inputs[i * count + n]
+	void evaluateBatch(const ValueType* inputs, ValueType* outputs, const int count) const;
+
+	// The critical path latency from the inputs to the last register in cycles
+	int latency() const;
+
+	// The sum of the reciprocal throughputs, i.e. the cycles the instructions take when they aren't dependent
+	float throughputCost() const;
+
+	void print() const;
+
+	// Write the instructions as a JSON array of { "op", "x", "y", "imm" } objects
+	void printJson(FILE* file) const;
+
+	// Write the program as a C function "static int32_t name(int32_t r0, ..)", the ops it calls are written by
+	// ISA_WriteCOps
+	void printC(FILE* file, const char* name) const;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  PROGRAM_H_HAS_BEEN_INCLUDED
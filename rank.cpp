@@ -0,0 +1,329 @@
+#include	"rank.h"
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<algorithm>
+#include	<string>
+#include	<vector>
+
+#ifdef _WIN32
+#define		popen	_popen
+#define		pclose	_pclose
+#endif
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Rule out a program, and the programs which only differ from it in operands its opcodes don't read
+static void BlockProgram(CodeGenContext& codeGen, const Program& program)
+{
+	z3::expr_vector differs(codeGen.ctx);
+	for (int idx = codeGen.numInputs; idx < codeGen.numInstr; idx++)
+	{
+		const int opcode = program.opcode[idx];
+		int localID = 0;
+		while (codeGen.isa.isaOpCode(localID) != opcode)
+		{
+			localID++;
+		}
+
+		differs.push_back(!codeGen.opCode[idx].eq(localID));
+
+		const int arity = ISA_OpArity(opcode);
+		if (arity >= 1)
+		{
+			differs.push_back(!codeGen.regX[idx].eq(program.regX[idx]));
+		}
+
+		if (arity >= 2)
+		{
+			differs.push_back(!codeGen.regY[idx].eq(program.regY[idx]));
+		}
+
+		if (ISA_OpUsesImm(opcode))
+		{
+			differs.push_back(codeGen.imm32[idx] != codeGen.ctx.bv_val(program.imm[idx], codeGen.bitWidth));
+		}
+	}
+
+	codeGen.solver.add(z3::mk_or(differs));
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Find up to maxSolutions distinct programs of the given length which pass the tests. Each program found is blocked
+// and the same solver is re-checked until it is unsatisfiable, returns sat if any program was found.
+static z3::check_result FindAllSolutions(const int numInstructions, const ISASubset& isa, const SynthOptions& options, const int maxSolutions, std::vector<Program>& programs)
+{
+	z3::context ctx;
+
+	const int numInitialChains = 2;
+	const int numInputs = 1;
+
+	CodeGenContext codeGen(ctx, numInputs, numInstructions, isa, options);
+	codeGen.verbose = false;
+
+	CreateConstants(codeGen);
+	AddConstraints(codeGen);
+	AddPerChainConstraints(codeGen, numInitialChains);
+
+	auto res = z3::unknown;
+	while (static_cast<int>(programs.size()) < maxSolutions)
+	{
+		res = SolveVerified(codeGen);
+		if (res != z3::sat)
+		{
+			break;
+		}
+
+		programs.push_back(DecodeProgram(codeGen));
+		BlockProgram(codeGen, programs.back());
+	}
+
+	printf("  %d programs (%lld ms, %d chains)\n", static_cast<int>(programs.size()), codeGen.solveTimeMs, codeGen.numChains);
+	if (res == z3::unknown)
+	{
+		printf("  stopped early: %s\n", UnknownReason(codeGen).c_str());
+	}
+
+	return programs.empty() ? res : z3::sat;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct RankedProgram
+{
+	Program             program;
+	int                 index = 0;
+	double              latencyNs = 0.0;
+	double              throughputNs = 0.0;
+};
+
+// Write the programs as C functions with a main which times each of them: the latency is a chain of calls which each
+// depend on the previous result and the throughput is independent calls over an array of inputs, the best of a few 
+// repeats in nanoseconds per call. main prints "index latency throughput" for each program.
+static bool WriteRankHarness(const char* path, const std::vector<RankedProgram>& ranked)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	fprintf(file, "/* Written by codegen --rank, compile with -O2 -fwrapv */\n\n");
+	fprintf(file, "#include <stdint.h>\n#include <stdio.h>\n\n");
+
+	ISA_WriteCOps(file);
+
+	for (const RankedProgram& entry: ranked)
+	{
+		char name[32];
+		sprintf(name, "candidate_%d", entry.index);
+		entry.program.printC(file, name);
+	}
+
+	fprintf(file,
+		"#define NUM_INPUTS 4096\n"
+		"#define NUM_REPEATS 256\n"
+		"#define NUM_TRIALS 5\n\n"
+		"static int32_t inputs[NUM_INPUTS];\n"
+		"static volatile int32_t sink;\n\n"
+		"#ifdef _WIN32\n"
+		"#include <windows.h>\n\n"
+		"static double NowNs(void)\n"
+		"{\n"
+		"\tLARGE_INTEGER counter, frequency;\n"
+		"\tQueryPerformanceCounter(&counter);\n"
+		"\tQueryPerformanceFrequency(&frequency);\n"
+		"\treturn counter.QuadPart * (1e9 / frequency.QuadPart);\n"
+		"}\n"
+		"#else\n"
+		"#include <time.h>\n\n"
+		"static double NowNs(void)\n"
+		"{\n"
+		"\tstruct timespec ts;\n"
+		"\tclock_gettime(CLOCK_MONOTONIC, &ts);\n"
+		"\treturn ts.tv_sec * 1e9 + ts.tv_nsec;\n"
+		"}\n"
+		"#endif\n\n"
+		"#define BENCH(fn, index) \\\n"
+		"\t{ \\\n"
+		"\t\tdouble latency = 1e30, throughput = 1e30; \\\n"
+		"\t\tfor (int trial = 0; trial < NUM_TRIALS; trial++) \\\n"
+		"\t\t{ \\\n"
+		"\t\t\tint32_t x = inputs[trial]; \\\n"
+		"\t\t\tdouble start = NowNs(); \\\n"
+		"\t\t\tfor (int i = 0; i < NUM_INPUTS * NUM_REPEATS; i++) x = fn(x); \\\n"
+		"\t\t\tdouble t = (NowNs() - start) / (NUM_INPUTS * NUM_REPEATS); \\\n"
+		"\t\t\tlatency = t < latency ? t : latency; \\\n"
+		"\t\t\tsink = x; \\\n"
+		"\t\t\tint32_t sum = 0; \\\n"
+		"\t\t\tstart = NowNs(); \\\n"
+		"\t\t\tfor (int r = 0; r < NUM_REPEATS; r++) \\\n"
+		"\t\t\t\tfor (int i = 0; i < NUM_INPUTS; i++) sum += fn(inputs[i] + r); \\\n"
+		"\t\t\tt = (NowNs() - start) / (NUM_INPUTS * NUM_REPEATS); \\\n"
+		"\t\t\tthroughput = t < throughput ? t : throughput; \\\n"
+		"\t\t\tsink = sum; \\\n"
+		"\t\t} \\\n"
+		"\t\tprintf(\"%%d %%f %%f\\n\", index, latency, throughput); \\\n"
+		"\t}\n\n"
+		"int main(void)\n"
+		"{\n"
+		"\tuint32_t seed = 12345;\n"
+		"\tfor (int i = 0; i < NUM_INPUTS; i++)\n"
+		"\t{\n"
+		"\t\tseed = seed * 1664525u + 1013904223u;\n"
+		"\t\tinputs[i] = (int32_t)seed;\n"
+		"\t}\n\n");
+
+	for (const RankedProgram& entry: ranked)
+	{
+		fprintf(file, "\tBENCH(candidate_%d, %d)\n", entry.index, entry.index);
+	}
+
+	fprintf(file, "\treturn 0;\n}\n");
+	fclose(file);
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Quote a path for the shell which system() and popen() run the command with
+static std::string ShellQuote(const std::string& arg)
+{
+#ifdef _WIN32
+	// cmd.exe has no way to escape a quote inside quotes, but a path can't contain one
+	return "\"" + arg + "\"";
+#else
+	std::string quoted = "'";
+	for (const char c: arg)
+	{
+		quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+	}
+
+	return quoted + "'";
+#endif
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Compile the harness with $CC (cc by default) and run it, returns false if either failed. $CC is left unquoted as
+// it may have arguments of its own (e.g. "ccache gcc"), the paths are quoted.
+static bool MeasurePrograms(const char* sourcePath, std::vector<RankedProgram>& ranked)
+{
+	std::string exePath = sourcePath;
+	if (exePath.size() > 2 && exePath.compare(exePath.size() - 2, 2, ".c") == 0)
+	{
+		exePath.resize(exePath.size() - 2);
+	}
+	else
+	{
+		exePath += ".out";
+	}
+
+	if (exePath.find('/') == std::string::npos)
+	{
+		exePath = "./" + exePath;
+	}
+
+	const char* cc = getenv("CC") ? getenv("CC") : "cc";
+	const std::string compile = std::string(cc) + " -O2 -fwrapv -o " + ShellQuote(exePath) + " " + ShellQuote(sourcePath);
+	printf("Compiling: %s\n", compile.c_str());
+	fflush(stdout);
+	if (system(compile.c_str()) != 0)
+	{
+		return false;
+	}
+
+	FILE* pipe = popen(ShellQuote(exePath).c_str(), "r");
+	if (!pipe)
+	{
+		return false;
+	}
+
+	int numMeasured = 0;
+	int index = 0;
+	double latencyNs = 0.0;
+	double throughputNs = 0.0;
+	while (fscanf(pipe, "%d %lf %lf", &index, &latencyNs, &throughputNs) == 3)
+	{
+		for (RankedProgram& entry: ranked)
+		{
+			if (entry.index == index)
+			{
+				entry.latencyNs = latencyNs;
+				entry.throughputNs = throughputNs;
+				numMeasured++;
+			}
+		}
+	}
+
+	return pclose(pipe) == 0 && numMeasured == static_cast<int>(ranked.size());
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool RankSolutions(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options, const int maxSolutions, const char* sourcePath)
+{
+	SynthOptions rankOptions = options;
+	rankOptions.symmetryBreaking = true;
+	if (rankOptions.inputSelection == InputSelection::Random)
+	{
+		rankOptions.inputSelection = InputSelection::Edge;
+	}
+
+	std::vector<Program> programs;
+	for (int i = minInstructions; i < maxInstructions && programs.empty(); i++)
+	{
+		printf("Try with %d instructions...\n", i);
+		FindAllSolutions(i, isa, rankOptions, maxSolutions, programs);
+	}
+
+	if (programs.empty())
+	{
+		printf("No solution found\n");
+		return false;
+	}
+
+	std::vector<RankedProgram> ranked(programs.size());
+	for (int i = 0; i < static_cast<int>(programs.size()); i++)
+	{
+		ranked[i].program = programs[i];
+		ranked[i].index = i;
+	}
+
+	const bool byLatency = options.costObjective == CostObjective::Latency;
+	if (!WriteRankHarness(sourcePath, ranked) || !MeasurePrograms(sourcePath, ranked))
+	{
+		printf("Couldn't compile and run %s, ranking by the ISA table's costs instead\n", sourcePath);
+		for (RankedProgram& entry: ranked)
+		{
+			entry.latencyNs = entry.program.latency();
+			entry.throughputNs = entry.program.throughputCost();
+		}
+	}
+
+	std::stable_sort(ranked.begin(), ranked.end(), [byLatency](const RankedProgram& a, const RankedProgram& b)
+	{
+		return byLatency ? a.latencyNs < b.latencyNs : a.throughputNs < b.throughputNs;
+	});
+
+	printf("\nRanked by %s:\n\n", byLatency ? "latency" : "throughput");
+	for (int rank = 0; rank < static_cast<int>(ranked.size()); rank++)
+	{
+		const RankedProgram& entry = ranked[rank];
+		printf("#%d candidate_%d: latency %.3f, throughput %.3f (model: %d cycles latency, %.2f cycles throughput)\n", 
+			rank + 1, entry.index, entry.latencyNs, entry.throughputNs, entry.program.latency(), entry.program.throughputCost());
+		entry.program.print();
+	}
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,19 @@
+#ifndef		RANK_H_HAS_BEEN_INCLUDED
+#define		RANK_H_HAS_BEEN_INCLUDED
+
+#include	"codegen.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Find every distinct program of the shortest length, then compile and time them and print them ranked by the 
+// measured latency (--cost latency) or throughput (otherwise). Symmetry breaking is always on so programs which only
+// differ in the order of commutative operands or independent instructions aren't counted as distinct, and the 
+// programs are also tested with the boundary inputs as otherwise most of the "distinct" programs are the first one
+// with a different constant that is only wrong for a few inputs the random tests don't hit.
+bool RankSolutions(const int minInstructions, const int maxInstructions, const ISASubset& isa, const SynthOptions& options, const int maxSolutions, const char* sourcePath);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  RANK_H_HAS_BEEN_INCLUDED
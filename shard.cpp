@@ -0,0 +1,211 @@
+#include	"shard.h"
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<algorithm>
+#include	<chrono>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Append the cubes for instructions idx to lastIdx to prefix. Operands the opcode doesn't read are fixed at 0 and 
+// commutative ops only have regX <= regY, any program in the cubes left out has an equivalent one in a cube which is
+// kept so the cubes still cover every program. What the sketch fixes is used as it is: only its opcodes are tried,
+// its operands are the only ones tried and a commutative op with a fixed operand is not reordered.
+static void AddCubes(ISASubset& isa, const Sketch* sketch, const int idx, const int lastIdx, const std::string& prefix, std::vector<std::string>& cubes)
+{
+	if (idx > lastIdx)
+	{
+		cubes.push_back(prefix);
+		return;
+	}
+
+	const SketchSlot* slot = sketch ? sketch->slot(idx) : nullptr;
+	const int fixedX = slot ? slot->regX : -1;
+	const int fixedY = slot ? slot->regY : -1;
+
+	const std::vector<int> commutative = isa.opCodesForKindMask(Instruction::Kind_Commutative);
+	for (int opcodeIdx = 0; opcodeIdx < isa.size(); opcodeIdx++)
+	{
+		if (slot && !slot->opcodes.empty() && 
+			std::find(slot->opcodes.begin(), slot->opcodes.end(), isa.isaOpCode(opcodeIdx)) == slot->opcodes.end())
+		{
+			continue;
+		}
+
+		const int arity = isa.opArity(opcodeIdx);
+		const bool isCommutative = fixedX < 0 && fixedY < 0 && 
+			std::find(commutative.begin(), commutative.end(), opcodeIdx) != commutative.end();
+
+		const int endX = fixedX >= 0 ? fixedX + 1 : arity >= 1 ? idx : 1;
+		for (int x = std::max(fixedX, 0); x < endX; x++)
+		{
+			const int endY = fixedY >= 0 ? fixedY + 1 : arity >= 2 ? idx : 1;
+			for (int y = fixedY >= 0 ? fixedY : isCommutative ? x : 0; y < endY; y++)
+			{
+				const std::string cube = " " + std::to_string(opcodeIdx) + " " + std::to_string(x) + " " + std::to_string(y);
+				AddCubes(isa, sketch, idx + 1, lastIdx, prefix + cube, cubes);
+			}
+		}
+	}
+}
+
+// Split a length into cubes by fixing the first shardDepth instructions, each cube is a job for SolveCube: the length
+// followed by the local opcode, regX and regY of each fixed instruction
+static std::vector<std::string> MakeCubes(const int numInstructions, const ISASubset& isa, const Sketch* sketch, const int shardDepth)
+{
+	const int numInputs = 1;
+	const int lastIdx = std::min(numInputs + shardDepth, numInstructions) - 1;
+
+	ISASubset subset = isa;
+	std::vector<std::string> cubes;
+	AddCubes(subset, sketch, numInputs, lastIdx, std::to_string(numInstructions), cubes);
+	return cubes;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+std::string SolveCube(const std::string& job, const ISASubset& isa, const SynthOptions& options)
+{
+	const int numChains = options.useCEGIS ? 2 : 10;
+	const int numInputs = 1;
+
+	const char* p = job.c_str();
+	char* end = nullptr;
+	const int numInstructions = strtol(p, &end, 10);
+	p = end;
+
+	try
+	{
+		z3::context ctx;
+		CodeGenContext codeGen(ctx, numInputs, numInstructions, isa, options);
+		codeGen.verbose = false;
+
+		CreateConstants(codeGen);
+		AddConstraints(codeGen);
+
+		for (int idx = numInputs; idx < numInstructions; idx++)
+		{
+			const int opcodeIdx = strtol(p, &end, 10);
+			if (end == p)
+			{
+				break;
+			}
+
+			const int x = strtol(end, &end, 10);
+			const int y = strtol(end, &end, 10);
+			p = end;
+
+			codeGen.solver.add(codeGen.opCode[idx].eq(opcodeIdx));
+			codeGen.solver.add(codeGen.regX[idx].eq(x));
+			codeGen.solver.add(codeGen.regY[idx].eq(y));
+		}
+
+		AddPerChainConstraints(codeGen, numChains);
+
+		const auto res = SolveVerified(codeGen);
+		if (res != z3::sat)
+		{
+			return res == z3::unsat ? "unsat" : "unknown";
+		}
+
+		const Program program = DecodeProgram(codeGen);
+		std::string reply = "sat " + std::to_string(codeGen.exhaustiveMs);
+		for (int idx = numInputs; idx < program.size(); idx++)
+		{
+			char instruction[64];
+			sprintf(instruction, " %d %d %d %d", program.opcode[idx], program.regX[idx], program.regY[idx], program.imm[idx]);
+			reply += instruction;
+		}
+
+		return reply;
+	}
+	catch (z3::exception&)
+	{
+		return "unknown";
+	}
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+z3::check_result FindSolutionSharded(const int numInstructions, const ISASubset& isa, const SynthOptions& options, WorkerPool& pool, Program* foundProgram)
+{
+	const int numInputs = 1;
+
+	const std::vector<std::string> cubes = MakeCubes(numInstructions, isa, options.sketch, options.shardDepth);
+	printf("  %d cubes on %d workers\n", static_cast<int>(cubes.size()), pool.size());
+
+	int numFinished = 0;
+	int numUnsat = 0;
+	int numUnknown = 0;
+	long long exhaustiveMs = -1;
+	int satCube = -1;
+	Program program;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	const bool completed = pool.run(cubes, [&](const int cubeIdx, const std::string& result)
+	{
+		numFinished++;
+		if (result.compare(0, 3, "sat") != 0)
+		{
+			numUnsat += result == "unsat" ? 1 : 0;
+			numUnknown += result == "unsat" ? 0 : 1;
+			return true;
+		}
+
+		const char* p = result.c_str() + 3;
+		char* end = nullptr;
+		exhaustiveMs = strtoll(p, &end, 10);
+		satCube = cubeIdx;
+
+		program.numInputs = numInputs;
+		program.resize(numInstructions);
+		for (int idx = numInputs; idx < numInstructions; idx++)
+		{
+			program.opcode[idx] = strtol(end, &end, 10);
+			program.regX[idx] = strtol(end, &end, 10);
+			program.regY[idx] = strtol(end, &end, 10);
+			program.imm[idx] = static_cast<ValueType>(strtol(end, &end, 10));
+		}
+
+		return false;
+	});
+
+	const auto delta = std::chrono::high_resolution_clock::now() - start;
+	printf("  cubes completed: %lld ms\n", static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(delta).count()));
+
+	if (program.size() == 0)
+	{
+		// the pool stops early if it can't reach the workers, the cubes which weren't run prove nothing
+		if (!completed || numFinished < static_cast<int>(cubes.size()))
+		{
+			printf("  unknown (only %d of %d cubes finished)\n", numFinished, static_cast<int>(cubes.size()));
+			return z3::unknown;
+		}
+
+		if (numUnknown > 0)
+		{
+			printf("  unknown (%d of %d cubes)\n", numUnknown, static_cast<int>(cubes.size()));
+			return z3::unknown;
+		}
+
+		printf("  unsatifiable (%d cubes)\n", numUnsat);
+		return z3::unsat;
+	}
+
+	printf("  satisified! (cube %d of %d, after %d unsatisfiable cubes)\n\n", satCube + 1, static_cast<int>(cubes.size()), numUnsat);
+
+	PrintSolution(program, exhaustiveMs);
+
+	if (foundProgram)
+	{
+		*foundProgram = program;
+	}
+
+	return z3::sat;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
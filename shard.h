@@ -0,0 +1,24 @@
+#ifndef		SHARD_H_HAS_BEEN_INCLUDED
+#define		SHARD_H_HAS_BEEN_INCLUDED
+
+#include	<string>
+
+#include	"codegen.h"
+#include	"workers.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Run in a worker process: solve one cube and reply with "unsat", "unknown" or "sat" followed by how long the 
+// exhaustive test took (-1 without --exhaustive) and the ISA opcode, regX, regY and immediate of each instruction
+std::string SolveCube(const std::string& job, const ISASubset& isa, const SynthOptions& options);
+
+// Cube and conquer: split the length into cubes and solve them on the worker processes. The length is satisfied as 
+// soon as any cube is, at which point the other cubes are abandoned, and is only unsatisfiable once every cube has 
+// been proven unsatisfiable.
+z3::check_result FindSolutionSharded(const int numInstructions, const ISASubset& isa, const SynthOptions& options, WorkerPool& pool, Program* foundProgram = nullptr);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  SHARD_H_HAS_BEEN_INCLUDED
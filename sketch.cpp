@@ -0,0 +1,230 @@
+#include	"sketch.h"
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<algorithm>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+std::vector<int> Sketch::opcodes() const
+{
+	std::vector<int> result;
+	for (const SketchSlot& slot: slots)
+	{
+		for (const int opcode: slot.opcodes)
+		{
+			if (std::find(result.begin(), result.end(), opcode) == result.end())
+			{
+				result.push_back(opcode);
+			}
+		}
+	}
+
+	return result;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Parses "r<n>", returns -1 if the token isn't a register
+static int ParseRegister(const std::string& token)
+{
+	if (token.size() < 2 || token[0] != 'r')
+	{
+		return -1;
+	}
+
+	char* end = nullptr;
+	const long reg = strtol(token.c_str() + 1, &end, 10);
+	return *end == '\0' && reg >= 0 ? static_cast<int>(reg) : -1;
+}
+
+static bool ParseValue(const std::string& token, ValueType& value)
+{
+	char* end = nullptr;
+	value = static_cast<ValueType>(strtoll(token.c_str(), &end, 0));
+	return !token.empty() && *end == '\0';
+}
+
+static int OpCodeForName(const std::string& name)
+{
+	for (int i = 0; i < ISA_NumOpCodes(); i++)
+	{
+		if (name == ISA_OpName(i))
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool ParseSketchLine(const char* line, Sketch& sketch, std::string& error)
+{
+	std::vector<std::string> tokens;
+	char buffer[1024];
+	strncpy(buffer, line, sizeof(buffer) - 1);
+	buffer[sizeof(buffer) - 1] = '\0';
+	for (const char* token = strtok(buffer, " \t\r\n"); token && token[0] != '#'; token = strtok(nullptr, " \t\r\n"))
+	{
+		tokens.push_back(token);
+	}
+
+	const int idx = tokens.empty() ? -1 : ParseRegister(tokens[0]);
+	if (idx < 1 || tokens.size() < 3 || (tokens[1] != "=" && tokens[1] != "reads"))
+	{
+		error = "expected \"r<n> = opcodes [x=..] [y=..] [imm=..]\" or \"r<n> reads r<m>\"";
+		return false;
+	}
+
+	if (static_cast<int>(sketch.slots.size()) <= idx)
+	{
+		sketch.slots.resize(idx + 1);
+	}
+
+	SketchSlot& slot = sketch.slots[idx];
+
+	// an operand has to be one of the registers before the instruction
+	auto parseOperand = [&](const std::string& token, int& reg)
+	{
+		reg = ParseRegister(token);
+		if (reg < 0 || reg >= idx)
+		{
+			error = "r" + std::to_string(idx) + " can't read " + token + ", only r0 to r" + std::to_string(idx - 1);
+			return false;
+		}
+
+		return true;
+	};
+
+	if (tokens[1] == "reads")
+	{
+		for (size_t i = 2; i < tokens.size(); i++)
+		{
+			int reg = -1;
+			if (!parseOperand(tokens[i], reg))
+			{
+				return false;
+			}
+
+			slot.reads.push_back(reg);
+		}
+
+		return true;
+	}
+
+	if (tokens[2] != "?")
+	{
+		char names[256];
+		strncpy(names, tokens[2].c_str(), sizeof(names) - 1);
+		names[sizeof(names) - 1] = '\0';
+		for (const char* name = strtok(names, "|"); name; name = strtok(nullptr, "|"))
+		{
+			const int opcode = OpCodeForName(name);
+			if (opcode < 0)
+			{
+				error = std::string("unknown opcode ") + name;
+				return false;
+			}
+
+			slot.opcodes.push_back(opcode);
+		}
+	}
+
+	for (size_t i = 3; i < tokens.size(); i++)
+	{
+		const std::string& token = tokens[i];
+		const size_t eq = token.find('=');
+		const std::string key = token.substr(0, eq);
+		const std::string value = eq == std::string::npos ? std::string() : token.substr(eq + 1);
+		if (eq == std::string::npos || value.empty())
+		{
+			error = "expected x=, y= or imm= at \"" + token + "\"";
+			return false;
+		}
+
+		if (value == "?")
+		{
+			continue;
+		}
+
+		if (key == "x" || key == "y")
+		{
+			if (!parseOperand(value, key == "x" ? slot.regX : slot.regY))
+			{
+				return false;
+			}
+		}
+		else if (key == "imm")
+		{
+			// a single value or an inclusive range lo..hi
+			const size_t dots = value.find("..");
+			const std::string lo = value.substr(0, dots);
+			const std::string hi = dots == std::string::npos ? lo : value.substr(dots + 2);
+			if (!ParseValue(lo, slot.immMin) || !ParseValue(hi, slot.immMax) || slot.immMin > slot.immMax)
+			{
+				error = "expected imm=value or imm=lo..hi at \"" + token + "\"";
+				return false;
+			}
+
+			slot.boundImm = true;
+		}
+		else
+		{
+			error = "expected x=, y= or imm= at \"" + token + "\"";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool LoadSketch(const char* path, Sketch& sketch)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+	{
+		printf("Couldn't open sketch file: %s\n", path);
+		return false;
+	}
+
+	char buffer[1024];
+	int lineNumber = 0;
+	bool ok = true;
+	while (ok && fgets(buffer, sizeof(buffer), file))
+	{
+		lineNumber++;
+
+		const char* line = buffer;
+		while (*line == ' ' || *line == '\t')
+		{
+			line++;
+		}
+
+		if (*line == '#' || *line == '\r' || *line == '\n' || *line == '\0')
+		{
+			continue;
+		}
+
+		std::string error;
+		if (!ParseSketchLine(line, sketch, error))
+		{
+			printf("%s:%d: %s\n", path, lineNumber, error.c_str());
+			ok = false;
+		}
+	}
+
+	fclose(file);
+	return ok;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
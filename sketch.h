@@ -0,0 +1,75 @@
+#ifndef		SKETCH_H_HAS_BEEN_INCLUDED
+#define		SKETCH_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+#include	<string>
+
+#include	"isa.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// What is known about one instruction of the program, every field left at its default is free
+struct SketchSlot
+{
+	// the ISA[] opcodes the instruction can be, empty for any opcode in the ISA subset
+	std::vector<int>        opcodes;
+
+	// the registers read as x and y, -1 for any
+	int                     regX = -1;
+	int                     regY = -1;
+
+	// the immediate is in [immMin, immMax] (signed) when boundImm is set
+	bool                    boundImm = false;
+	ValueType               immMin = 0;
+	ValueType               immMax = 0;
+
+	// registers the instruction has to read as either x or y
+	std::vector<int>        reads;
+
+	bool constrained() const
+	{
+		return !opcodes.empty() || regX >= 0 || regY >= 0 || boundImm || !reads.empty();
+	}
+};
+
+// A partial program read from a sketch file. Each line constrains one instruction, fields which are left out or
+// written as ? are free:
+//
+//   r1 = shr x=r0 imm=31       fully fixed
+//   r2 = sub|xor               the opcode is one of a set
+//   r3 = ? x=r1                only the first operand is fixed
+//   r4 = set imm=-16..16       the immediate is bounded
+//   r4 reads r2                r4 reads r2 as x or y
+//
+// Lines starting with # are comments. Registers are numbered as in the printed programs, r0 is the input and an
+// instruction can only read the registers before it. Instructions past the end of a program length are ignored.
+struct Sketch
+{
+	// indexed by instruction
+	std::vector<SketchSlot> slots;
+
+	// nullptr if nothing is known about the instruction
+	const SketchSlot* slot(const int idx) const
+	{
+		return idx < static_cast<int>(slots.size()) && slots[idx].constrained() ? &slots[idx] : nullptr;
+	}
+
+	// every opcode named in the sketch
+	std::vector<int> opcodes() const;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Returns false and sets error if the line could not be parsed, the line is merged with what is already known about
+// its instruction
+bool ParseSketchLine(const char* line, Sketch& sketch, std::string& error);
+
+// Read a sketch file, returns false after printing the first error
+bool LoadSketch(const char* path, Sketch& sketch);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  SKETCH_H_HAS_BEEN_INCLUDED
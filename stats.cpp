@@ -0,0 +1,92 @@
+#include	"stats.h"
+#include	"json.h"
+
+#include	<stdio.h>
+
+#ifdef _WIN32
+#include	<windows.h>
+#include	<psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include	<sys/resource.h>
+#endif
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+long long PeakRSSKb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return static_cast<long long>(counters.PeakWorkingSetSize / 1024);
+	}
+
+	return 0;
+#else
+	// ru_maxrss is already in KB on Linux
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		return static_cast<long long>(usage.ru_maxrss);
+	}
+
+	return 0;
+#endif
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+StatsLog::StatsLog()
+	: start_(std::chrono::high_resolution_clock::now())
+{
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+void StatsLog::addLength(const std::string& json)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	lengths_.push_back(json);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool StatsLog::write(const char* path, const std::vector<std::string>& args)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	const auto delta = std::chrono::high_resolution_clock::now() - start_;
+	const long long totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(delta).count();
+
+	fprintf(file, "{\n  \"run\": { \"args\": [");
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		fprintf(file, "%s%s", i > 0 ? ", " : "", JsonString(args[i]).c_str());
+	}
+
+	fprintf(file, "], \"total_ms\": %lld, \"peak_rss_kb\": %lld, \"num_lengths\": %d },\n", 
+		totalMs, PeakRSSKb(), static_cast<int>(lengths_.size()));
+
+	fprintf(file, "  \"lengths\": [\n");
+	for (size_t i = 0; i < lengths_.size(); i++)
+	{
+		fprintf(file, "    %s%s\n", lengths_[i].c_str(), i + 1 < lengths_.size() ? "," : "");
+	}
+
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,82 @@
+#ifndef		STATS_H_HAS_BEEN_INCLUDED
+#define		STATS_H_HAS_BEEN_INCLUDED
+
+#include	<string>
+#include	<vector>
+#include	<mutex>
+#include	<chrono>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Time spent in each phase of solving one program length, in microseconds
+struct PhaseTimes
+{
+	long long           createConstantsUs = 0;
+	long long           addConstraintsUs = 0;
+	long long           addChainsUs = 0;
+	long long           checkUs = 0;
+	long long           decodeUs = 0;
+	long long           verifyUs = 0;
+	int                 numChecks = 0;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Adds the time between construction and destruction to a PhaseTimes counter
+class ScopedTimer
+{
+public:
+
+	explicit ScopedTimer(long long& us)
+		: us_(us)
+		, start_(std::chrono::high_resolution_clock::now())
+	{
+	}
+
+	~ScopedTimer()
+	{
+		const auto delta = std::chrono::high_resolution_clock::now() - start_;
+		us_ += std::chrono::duration_cast<std::chrono::microseconds>(delta).count();
+	}
+
+private:
+
+	long long&                                          us_;
+	std::chrono::high_resolution_clock::time_point      start_;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The peak resident set size of the process in KB, 0 if it isn't available
+long long PeakRSSKb();
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Collects a JSON object for each program length which was solved and writes them out with a summary of the run.
+// Lengths can be added from any thread.
+class StatsLog
+{
+public:
+
+	StatsLog();
+
+	void addLength(const std::string& json);
+
+	// args is the command line, the file contains { "run": { .. }, "lengths": [ .. ] }
+	bool write(const char* path, const std::vector<std::string>& args);
+
+private:
+
+	std::mutex                                          mutex_;
+	std::vector<std::string>                            lengths_;
+	std::chrono::high_resolution_clock::time_point      start_;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  STATS_H_HAS_BEEN_INCLUDED
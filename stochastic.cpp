@@ -0,0 +1,301 @@
+#include	"stochastic.h"
+#include	"threadpool.h"
+
+#include	<algorithm>
+#include	<atomic>
+#include	<chrono>
+#include	<climits>
+#include	<cmath>
+#include	<mutex>
+#include	<random>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static const int NUM_TEST_VECTORS = 64;
+static const int NUM_VERIFY_TESTS = 10000;
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static int CountBits(uint32_t v)
+{
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	return static_cast<int>((((v + (v >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// The state of one chain: its current program, the test vectors it is scored against and a scratch buffer
+class StochasticChain
+{
+public:
+
+	StochasticChain(const ISASubset& isa, TargetFn target, const int length, const unsigned seed, const std::vector<ValueType>& testInputs)
+		: isa_(isa)
+		, target_(target)
+		, prng_(seed)
+		, shiftOpCodes_(ISA_OpCodesForKindMask(Instruction::Kind_Shift))
+	{
+		std::uniform_int_distribution<ValueType> rndDist(INT_MIN, INT_MAX);
+
+		// the edge cases are where most wrong programs fail so they are always in the test vectors, as are the inputs
+		// the candidates of earlier searches were wrong for
+		inputs_ = { 0, 1, -1, 2, -2, INT_MAX, INT_MIN, INT_MIN + 1 };
+		inputs_.insert(inputs_.end(), testInputs.begin(), testInputs.end());
+		while (static_cast<int>(inputs_.size()) < NUM_TEST_VECTORS)
+		{
+			inputs_.push_back(rndDist(prng_));
+		}
+
+		for (const ValueType x: inputs_)
+		{
+			expected_.push_back(target_(x));
+		}
+
+		program_.numInputs = 1;
+		program_.resize(length);
+		restart();
+	}
+
+	// Start again from a random program, used when the chain is stuck in a local minimum
+	void restart()
+	{
+		for (int idx = program_.numInputs; idx < program_.size(); idx++)
+		{
+			randomizeInstruction(idx);
+		}
+
+		cost_ = cost(program_);
+	}
+
+	// Propose a rewrite and accept or reject it, returns the cost of the current program
+	int step(const double beta)
+	{
+		Program proposal = program_;
+		mutate(proposal);
+
+		const int proposalCost = cost(proposal);
+		if (proposalCost <= cost_ || uniform_(prng_) < std::exp(-beta * (proposalCost - cost_)))
+		{
+			program_ = proposal;
+			cost_ = proposalCost;
+		}
+
+		return cost_;
+	}
+
+	// Check a zero cost program with random inputs, a failing input is added to the test vectors
+	bool verify()
+	{
+		std::uniform_int_distribution<ValueType> rndDist(INT_MIN, INT_MAX);
+
+		std::vector<ValueType> inputs(NUM_VERIFY_TESTS);
+		std::vector<ValueType> outputs(NUM_VERIFY_TESTS);
+		for (auto& x: inputs)
+		{
+			x = rndDist(prng_);
+		}
+
+		program_.evaluateBatch(inputs.data(), outputs.data(), NUM_VERIFY_TESTS);
+
+		for (int i = 0; i < NUM_VERIFY_TESTS; i++)
+		{
+			if (outputs[i] != target_(inputs[i]))
+			{
+				inputs_.push_back(inputs[i]);
+				expected_.push_back(target_(inputs[i]));
+				cost_ = cost(program_);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const Program& program() const
+	{
+		return program_;
+	}
+
+private:
+
+	int cost(const Program& program)
+	{
+		outputs_.resize(inputs_.size());
+		program.evaluateBatch(inputs_.data(), outputs_.data(), static_cast<int>(inputs_.size()));
+
+		int bits = 0;
+		for (size_t i = 0; i < inputs_.size(); i++)
+		{
+			bits += CountBits(static_cast<uint32_t>(outputs_[i] ^ expected_[i]));
+		}
+
+		return bits;
+	}
+
+	bool isShift(const int opcode) const
+	{
+		return std::find(shiftOpCodes_.begin(), shiftOpCodes_.end(), opcode) != shiftOpCodes_.end();
+	}
+
+	int randomInt(const int lo, const int hi)
+	{
+		return std::uniform_int_distribution<int>(lo, hi)(prng_);
+	}
+
+	// Small constants are much more likely to be useful than random 32 bit values
+	ValueType randomImmediate(const int opcode)
+	{
+		if (isShift(opcode))
+		{
+			return randomInt(1, 31);
+		}
+
+		switch (randomInt(0, 3))
+		{
+		case 0:     return std::uniform_int_distribution<ValueType>(INT_MIN, INT_MAX)(prng_);
+		case 1:     return static_cast<ValueType>(1u << randomInt(0, 31));
+		default:    return randomInt(-16, 16);
+		}
+	}
+
+	void randomizeInstruction(const int idx)
+	{
+		program_.opcode[idx] = isa_.isaOpCode(randomInt(0, isa_.size() - 1));
+		program_.regX[idx] = randomInt(0, idx - 1);
+		program_.regY[idx] = randomInt(0, idx - 1);
+		program_.imm[idx] = randomImmediate(program_.opcode[idx]);
+	}
+
+	void mutate(Program& program)
+	{
+		const int idx = randomInt(program.numInputs, program.size() - 1);
+		switch (randomInt(0, 3))
+		{
+		case 0:
+			program.opcode[idx] = isa_.isaOpCode(randomInt(0, isa_.size() - 1));
+			if (isShift(program.opcode[idx]) && (program.imm[idx] < 1 || program.imm[idx] > 31))
+			{
+				program.imm[idx] = randomImmediate(program.opcode[idx]);
+			}
+			break;
+
+		case 1:
+			program.regX[idx] = randomInt(0, idx - 1);
+			break;
+
+		case 2:
+			program.regY[idx] = randomInt(0, idx - 1);
+			break;
+
+		default:
+			if (!isShift(program.opcode[idx]) && randomInt(0, 1) == 0)
+			{
+				// flipping a single bit lets the chain walk towards a constant
+				program.imm[idx] ^= static_cast<ValueType>(1u << randomInt(0, 31));
+			}
+			else
+			{
+				program.imm[idx] = randomImmediate(program.opcode[idx]);
+			}
+			break;
+		}
+	}
+
+	const ISASubset&            isa_;
+	TargetFn                    target_;
+	std::mt19937                prng_;
+	std::uniform_real_distribution<double> uniform_;
+	std::vector<int>            shiftOpCodes_;
+
+	std::vector<ValueType>      inputs_;
+	std::vector<ValueType>      expected_;
+	std::vector<ValueType>      outputs_;
+
+	Program                     program_;
+	int                         cost_ = INT_MAX;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool StochasticSearch(const ISASubset& isa, TargetFn target, const int length, const StochasticOptions& options, Program& program, StochasticStats& stats)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	auto elapsedMs = [&]()
+	{
+		const auto delta = std::chrono::high_resolution_clock::now() - start;
+		return static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(delta).count());
+	};
+
+	std::mutex mutex;
+	std::atomic<bool> found(false);
+	std::atomic<long long> numIterations(0);
+	int bestCost = INT_MAX;
+
+	{
+		ThreadPool pool(options.numChains);
+		for (int chainIdx = 0; chainIdx < pool.size(); chainIdx++)
+		{
+			pool.submit([&, chainIdx]()
+			{
+				StochasticChain chain(isa, target, length, options.seed ^ (0x9e3779b9u * (chainIdx + 1)), options.testInputs);
+
+				int chainBestCost = INT_MAX;
+				int restartBestCost = INT_MAX;
+				long long lastImprovement = 0;
+				long long iteration = 0;
+				for (; iteration < options.maxIterations && !found; iteration++)
+				{
+					// the clock is only checked occasionally as a step is only a few hundred ns
+					if ((iteration & 0xfff) == 0 && elapsedMs() > options.timeBudgetMs)
+					{
+						break;
+					}
+
+					const int cost = chain.step(options.beta);
+					chainBestCost = std::min(chainBestCost, cost);
+					if (cost < restartBestCost)
+					{
+						restartBestCost = cost;
+						lastImprovement = iteration;
+					}
+					else if (iteration - lastImprovement > options.restartIterations)
+					{
+						chain.restart();
+						restartBestCost = INT_MAX;
+						lastImprovement = iteration;
+					}
+					if (cost == 0 && chain.verify())
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						if (!found)
+						{
+							program = chain.program();
+							found = true;
+						}
+					}
+				}
+
+				numIterations += iteration;
+
+				std::lock_guard<std::mutex> lock(mutex);
+				bestCost = std::min(bestCost, chainBestCost);
+			});
+		}
+
+		pool.wait();
+	}
+
+	stats.numIterations = numIterations;
+	stats.bestCost = found ? 0 : bestCost;
+	stats.timeMs = elapsedMs();
+
+	return found;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,54 @@
+#ifndef		STOCHASTIC_H_HAS_BEEN_INCLUDED
+#define		STOCHASTIC_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+
+#include	"isa.h"
+#include	"program.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct StochasticOptions
+{
+	// number of independent chains, each chain runs on its own thread
+	int                 numChains = 1;
+
+	long long           maxIterations = 20000000;
+	long long           timeBudgetMs = 5000;
+
+	// higher values make the chains less likely to accept a rewrite which increases the cost
+	double              beta = 0.1;
+
+	// a chain starts again from a random program when its cost hasn't improved for this many iterations
+	long long           restartIterations = 200000;
+
+	// each chain's random number generator is seeded from this and the chain's index
+	unsigned            seed = 0;
+
+	// inputs every chain is also scored against, e.g. where a candidate which was found before turned out to be wrong
+	std::vector<ValueType> testInputs;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+struct StochasticStats
+{
+	long long           numIterations = 0;
+	int                 bestCost = -1;
+	long long           timeMs = 0;
+};
+
+// Markov chain Monte Carlo search for a single input program of the given length. Each chain starts from a random
+// program and repeatedly rewrites an opcode, operand or immediate, the cost of a program is the number of bits its
+// outputs differ from the target over a batch of test vectors and rewrites are accepted with the Metropolis rule.
+// A chain which stops improving is restarted from a new random program.
+// A zero cost program is checked with random inputs, a failing input is added to that chain's test vectors. Returns
+// true and sets program when a chain finds a program which passes.
+bool StochasticSearch(const ISASubset& isa, TargetFn target, const int length, const StochasticOptions& options, Program& program, StochasticStats& stats);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  STOCHASTIC_H_HAS_BEEN_INCLUDED
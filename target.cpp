@@ -0,0 +1,533 @@
+#include	"target.h"
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<ctype.h>
+#include	<climits>
+#include	<memory>
+#include	<map>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A node of a parsed expression, the arithmetic is done on uint32_t so overflow wraps rather than being undefined
+struct ExprNode
+{
+	enum Op
+	{
+		Op_Const, Op_Input,
+		Op_Neg, Op_Not, Op_LogicalNot,
+		Op_Add, Op_Sub, Op_Mul, Op_Div, Op_Mod,
+		Op_And, Op_Or, Op_Xor, Op_Shl, Op_Shr,
+		Op_Lt, Op_Le, Op_Gt, Op_Ge, Op_Eq, Op_Ne,
+		Op_LogicalAnd, Op_LogicalOr,
+		Op_Select, Op_Abs, Op_Min, Op_Max,
+	};
+
+	Op                          op = Op_Const;
+	ValueType                   value = 0;
+	std::unique_ptr<ExprNode>   a;
+	std::unique_ptr<ExprNode>   b;
+	std::unique_ptr<ExprNode>   c;
+
+	ValueType evaluate(const ValueType x) const
+	{
+		switch (op)
+		{
+		case Op_Const:          return value;
+		case Op_Input:          return x;
+		case Op_Neg:            return static_cast<ValueType>(0u - (uint32_t)a->evaluate(x));
+		case Op_Not:            return ~a->evaluate(x);
+		case Op_LogicalNot:     return !a->evaluate(x);
+		case Op_Select:         return a->evaluate(x) ? b->evaluate(x) : c->evaluate(x);
+		case Op_LogicalAnd:     return a->evaluate(x) && b->evaluate(x);
+		case Op_LogicalOr:      return a->evaluate(x) || b->evaluate(x);
+		case Op_Abs:
+		{
+			const ValueType v = a->evaluate(x);
+			return v < 0 ? static_cast<ValueType>(0u - (uint32_t)v) : v;
+		}
+		default:                break;
+		}
+
+		const ValueType l = a->evaluate(x);
+		const ValueType r = b->evaluate(x);
+		switch (op)
+		{
+		case Op_Add:            return static_cast<ValueType>((uint32_t)l + (uint32_t)r);
+		case Op_Sub:            return static_cast<ValueType>((uint32_t)l - (uint32_t)r);
+		case Op_Mul:            return static_cast<ValueType>((uint32_t)l * (uint32_t)r);
+		case Op_Div:            return r == 0 || (l == INT_MIN && r == -1) ? 0 : l / r;
+		case Op_Mod:            return r == 0 || (l == INT_MIN && r == -1) ? 0 : l % r;
+		case Op_And:            return l & r;
+		case Op_Or:             return l | r;
+		case Op_Xor:            return l ^ r;
+		case Op_Shl:            return static_cast<ValueType>((uint32_t)l << (r & 31));
+		case Op_Shr:            return l >> (r & 31);
+		case Op_Lt:             return l < r;
+		case Op_Le:             return l <= r;
+		case Op_Gt:             return l > r;
+		case Op_Ge:             return l >= r;
+		case Op_Eq:             return l == r;
+		case Op_Ne:             return l != r;
+		case Op_Min:            return l < r ? l : r;
+		case Op_Max:            return l > r ? l : r;
+		default:                return 0;
+		}
+	}
+
+	// The same expression for the solver, with the same wrapping and the same results for division by zero
+	z3::expr simulate(const z3::expr& x) const
+	{
+		z3::context& ctx = x.ctx();
+		const unsigned bitWidth = x.get_sort().bv_size();
+		const z3::expr zero = ctx.bv_val(0, bitWidth);
+		const z3::expr one = ctx.bv_val(1, bitWidth);
+		auto boolValue = [&](const z3::expr& b) { return z3::ite(b, one, zero); };
+
+		switch (op)
+		{
+		case Op_Const:          return ctx.bv_val(value, bitWidth);
+		case Op_Input:          return x;
+		case Op_Neg:            return -a->simulate(x);
+		case Op_Not:            return ~a->simulate(x);
+		case Op_LogicalNot:     return boolValue(a->simulate(x) == zero);
+		case Op_Select:         return z3::ite(a->simulate(x) != zero, b->simulate(x), c->simulate(x));
+		case Op_LogicalAnd:     return boolValue(a->simulate(x) != zero && b->simulate(x) != zero);
+		case Op_LogicalOr:      return boolValue(a->simulate(x) != zero || b->simulate(x) != zero);
+		case Op_Abs:
+		{
+			const z3::expr v = a->simulate(x);
+			return z3::ite(v < zero, -v, v);
+		}
+		default:                break;
+		}
+
+		const z3::expr l = a->simulate(x);
+		const z3::expr r = b->simulate(x);
+		const z3::expr noDivide = r == zero || (l == ctx.bv_val(INT_MIN, bitWidth) && r == ctx.bv_val(-1, bitWidth));
+		const z3::expr shift = r & ctx.bv_val(31, bitWidth);
+		switch (op)
+		{
+		case Op_Add:            return l + r;
+		case Op_Sub:            return l - r;
+		case Op_Mul:            return l * r;
+		case Op_Div:            return z3::ite(noDivide, zero, l / r);
+		case Op_Mod:            return z3::ite(noDivide, zero, z3::to_expr(ctx, Z3_mk_bvsrem(ctx, l, r)));
+		case Op_And:            return l & r;
+		case Op_Or:             return l | r;
+		case Op_Xor:            return l ^ r;
+		case Op_Shl:            return ShiftLeft(l, shift);
+		case Op_Shr:            return ShiftRight(l, shift);
+		case Op_Lt:             return boolValue(l < r);
+		case Op_Le:             return boolValue(l <= r);
+		case Op_Gt:             return boolValue(l > r);
+		case Op_Ge:             return boolValue(l >= r);
+		case Op_Eq:             return boolValue(l == r);
+		case Op_Ne:             return boolValue(l != r);
+		case Op_Min:            return z3::ite(l < r, l, r);
+		case Op_Max:            return z3::ite(l > r, l, r);
+		default:                return zero;
+		}
+	}
+};
+
+using ExprPtr = std::unique_ptr<ExprNode>;
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Recursive descent parser, one function per C precedence level
+class ExprParser
+{
+public:
+
+	explicit ExprParser(const char* text)
+		: p_(text)
+	{
+	}
+
+	ExprPtr parse(std::string& error)
+	{
+		ExprPtr expr = parseSelect();
+		skipSpace();
+		if (error_.empty() && *p_)
+		{
+			fail("unexpected text");
+		}
+
+		error = error_;
+		return error_.empty() ? std::move(expr) : nullptr;
+	}
+
+private:
+
+	struct BinaryOp
+	{
+		const char*         token;
+		ExprNode::Op        op;
+	};
+
+	void skipSpace()
+	{
+		while (isspace(static_cast<unsigned char>(*p_)))
+		{
+			p_++;
+		}
+	}
+
+	void fail(const char* message)
+	{
+		if (error_.empty())
+		{
+			error_ = std::string(message) + " at \"" + p_ + "\"";
+		}
+	}
+
+	bool accept(const char* token)
+	{
+		skipSpace();
+		const size_t n = strlen(token);
+		if (strncmp(p_, token, n) != 0)
+		{
+			return false;
+		}
+
+		// don't match the prefix of a longer operator, e.g. < in <= or <<
+		const char next = p_[n];
+		const bool isSymbol = !isalnum(static_cast<unsigned char>(token[0]));
+		if (isSymbol && n == 1 && strchr("<>=&|", token[0]) && (next == '=' || next == token[0]))
+		{
+			return false;
+		}
+
+		if (isSymbol && n == 1 && token[0] == '!' && next == '=')
+		{
+			return false;
+		}
+
+		p_ += n;
+		return true;
+	}
+
+	void expect(const char* token)
+	{
+		if (!accept(token))
+		{
+			fail((std::string("expected ") + token).c_str());
+		}
+	}
+
+	static ExprPtr makeNode(const ExprNode::Op op, ExprPtr a, ExprPtr b = nullptr, ExprPtr c = nullptr)
+	{
+		ExprPtr node(new ExprNode);
+		node->op = op;
+		node->a = std::move(a);
+		node->b = std::move(b);
+		node->c = std::move(c);
+		return node;
+	}
+
+	template <typename NextFn>
+	ExprPtr parseBinary(const std::vector<BinaryOp>& ops, NextFn next)
+	{
+		ExprPtr lhs = (this->*next)();
+		while (error_.empty())
+		{
+			bool matched = false;
+			for (const BinaryOp& binaryOp: ops)
+			{
+				if (accept(binaryOp.token))
+				{
+					lhs = makeNode(binaryOp.op, std::move(lhs), (this->*next)());
+					matched = true;
+					break;
+				}
+			}
+
+			if (!matched)
+			{
+				break;
+			}
+		}
+
+		return lhs;
+	}
+
+	ExprPtr parseSelect()
+	{
+		ExprPtr cond = parseLogicalOr();
+		if (!accept("?"))
+		{
+			return cond;
+		}
+
+		ExprPtr a = parseSelect();
+		expect(":");
+		ExprPtr b = parseSelect();
+		return makeNode(ExprNode::Op_Select, std::move(cond), std::move(a), std::move(b));
+	}
+
+	ExprPtr parseLogicalOr()    { return parseBinary({ { "||", ExprNode::Op_LogicalOr } }, &ExprParser::parseLogicalAnd); }
+	ExprPtr parseLogicalAnd()   { return parseBinary({ { "&&", ExprNode::Op_LogicalAnd } }, &ExprParser::parseOr); }
+	ExprPtr parseOr()           { return parseBinary({ { "|", ExprNode::Op_Or } }, &ExprParser::parseXor); }
+	ExprPtr parseXor()          { return parseBinary({ { "^", ExprNode::Op_Xor } }, &ExprParser::parseAnd); }
+	ExprPtr parseAnd()          { return parseBinary({ { "&", ExprNode::Op_And } }, &ExprParser::parseEquality); }
+
+	ExprPtr parseEquality()
+	{
+		return parseBinary({ { "==", ExprNode::Op_Eq }, { "!=", ExprNode::Op_Ne } }, &ExprParser::parseRelational);
+	}
+
+	ExprPtr parseRelational()
+	{
+		return parseBinary({ { "<=", ExprNode::Op_Le }, { ">=", ExprNode::Op_Ge }, { "<", ExprNode::Op_Lt }, { ">", ExprNode::Op_Gt } },
+			&ExprParser::parseShift);
+	}
+
+	ExprPtr parseShift()
+	{
+		return parseBinary({ { "<<", ExprNode::Op_Shl }, { ">>", ExprNode::Op_Shr } }, &ExprParser::parseAdditive);
+	}
+
+	ExprPtr parseAdditive()
+	{
+		return parseBinary({ { "+", ExprNode::Op_Add }, { "-", ExprNode::Op_Sub } }, &ExprParser::parseMultiplicative);
+	}
+
+	ExprPtr parseMultiplicative()
+	{
+		return parseBinary({ { "*", ExprNode::Op_Mul }, { "/", ExprNode::Op_Div }, { "%", ExprNode::Op_Mod } }, &ExprParser::parseUnary);
+	}
+
+	ExprPtr parseUnary()
+	{
+		if (accept("-"))        return makeNode(ExprNode::Op_Neg, parseUnary());
+		if (accept("~"))        return makeNode(ExprNode::Op_Not, parseUnary());
+		if (accept("!"))        return makeNode(ExprNode::Op_LogicalNot, parseUnary());
+		if (accept("+"))        return parseUnary();
+
+		return parsePrimary();
+	}
+
+	ExprPtr parseCall(const ExprNode::Op op, const int numArgs)
+	{
+		expect("(");
+		ExprPtr a = parseSelect();
+		ExprPtr b;
+		if (numArgs > 1)
+		{
+			expect(",");
+			b = parseSelect();
+		}
+
+		expect(")");
+		return makeNode(op, std::move(a), std::move(b));
+	}
+
+	ExprPtr parsePrimary()
+	{
+		skipSpace();
+		if (accept("("))
+		{
+			ExprPtr expr = parseSelect();
+			expect(")");
+			return expr;
+		}
+
+		if (isdigit(static_cast<unsigned char>(*p_)))
+		{
+			// parsed as unsigned so 0xffffffff is -1 rather than being clamped
+			char* end = nullptr;
+			const unsigned long long value = strtoull(p_, &end, 0);
+			p_ = end;
+
+			ExprPtr node(new ExprNode);
+			node->value = static_cast<ValueType>(static_cast<uint32_t>(value));
+			return node;
+		}
+
+		std::string ident;
+		while (isalnum(static_cast<unsigned char>(*p_)) || *p_ == '_')
+		{
+			ident += *p_++;
+		}
+
+		if (ident == "x")       return makeNode(ExprNode::Op_Input, nullptr);
+		if (ident == "abs")     return parseCall(ExprNode::Op_Abs, 1);
+		if (ident == "min")     return parseCall(ExprNode::Op_Min, 2);
+		if (ident == "max")     return parseCall(ExprNode::Op_Max, 2);
+
+		fail(ident.empty() ? "expected a value" : "unknown identifier");
+		return makeNode(ExprNode::Op_Const, nullptr);
+	}
+
+	const char*         p_;
+	std::string         error_;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool ParseTargetExpression(const char* text, TargetFn& func, SimTargetFn& sim, std::string& error)
+{
+	ExprParser parser(text);
+	ExprPtr expr = parser.parse(error);
+	if (!expr)
+	{
+		return false;
+	}
+
+	std::shared_ptr<ExprNode> root(expr.release());
+	func = [root](const ValueType x) { return root->evaluate(x); };
+	sim = [root](const z3::expr& x) { return root->simulate(x); };
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool ParseTargetTable(const char* text, TargetFn& func, std::vector<ValueType>& domain, std::string& error)
+{
+	auto table = std::make_shared<std::map<ValueType, ValueType>>();
+
+	const char* p = text;
+	while (true)
+	{
+		while (isspace(static_cast<unsigned char>(*p)) || *p == ',')
+		{
+			p++;
+		}
+
+		if (!*p)
+		{
+			break;
+		}
+
+		char* end = nullptr;
+		const ValueType input = static_cast<ValueType>(strtoll(p, &end, 0));
+		if (end == p)
+		{
+			error = std::string("expected an input at \"") + p + "\"";
+			return false;
+		}
+
+		p = end;
+		while (isspace(static_cast<unsigned char>(*p)))
+		{
+			p++;
+		}
+
+		if (strncmp(p, "->", 2) != 0)
+		{
+			error = std::string("expected -> at \"") + p + "\"";
+			return false;
+		}
+
+		p += 2;
+		const ValueType output = static_cast<ValueType>(strtoll(p, &end, 0));
+		if (end == p)
+		{
+			error = std::string("expected an output at \"") + p + "\"";
+			return false;
+		}
+
+		p = end;
+		if (!table->insert(std::make_pair(input, output)).second && (*table)[input] != output)
+		{
+			error = "input " + std::to_string(input) + " has two different outputs";
+			return false;
+		}
+	}
+
+	if (table->empty())
+	{
+		error = "empty table";
+		return false;
+	}
+
+	domain.clear();
+	for (const auto& entry: *table)
+	{
+		domain.push_back(entry.first);
+	}
+
+	// only ever called with the inputs in the domain
+	func = [table](const ValueType x)
+	{
+		const auto it = table->find(x);
+		return it != table->end() ? it->second : 0;
+	};
+
+	return true;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+static std::string Trim(const std::string& s)
+{
+	const size_t first = s.find_first_not_of(" \t\r\n");
+	const size_t last = s.find_last_not_of(" \t\r\n");
+	return first == std::string::npos ? std::string() : s.substr(first, last - first + 1);
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool LoadTargetSpecs(const char* path, std::vector<TargetSpec>& specs)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+	{
+		printf("Couldn't open target spec file: %s\n", path);
+		return false;
+	}
+
+	char buffer[4096];
+	int lineNumber = 0;
+	bool ok = true;
+	while (ok && fgets(buffer, sizeof(buffer), file))
+	{
+		lineNumber++;
+
+		const std::string line = Trim(buffer);
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		// the first of '=' or ':' separates the name from an expression or a table
+		const size_t sep = line.find_first_of("=:");
+		if (sep == std::string::npos || sep == 0)
+		{
+			printf("%s:%d: expected \"name = expression\" or \"name : table\"\n", path, lineNumber);
+			ok = false;
+			break;
+		}
+
+		TargetSpec spec;
+		spec.name = Trim(line.substr(0, sep));
+		spec.source = Trim(line.substr(sep + 1));
+
+		std::string error;
+		const bool parsed = line[sep] == '=' ?
+			ParseTargetExpression(spec.source.c_str(), spec.func, spec.sim, error) :
+			ParseTargetTable(spec.source.c_str(), spec.func, spec.domain, error);
+
+		if (!parsed)
+		{
+			printf("%s:%d: %s\n", path, lineNumber, error.c_str());
+			ok = false;
+			break;
+		}
+
+		specs.push_back(spec);
+	}
+
+	fclose(file);
+	return ok;
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
@@ -0,0 +1,48 @@
+#ifndef		TARGET_H_HAS_BEEN_INCLUDED
+#define		TARGET_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+#include	<string>
+
+#include	"isa.h"
+#include	"program.h"
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A target function read from a spec file. Each line of the file is either an expression over the input x:
+//
+//   abs = x >= 0 ? x : -x
+//
+// or an I/O table of input -> output pairs:
+//
+//   lut : 0 -> 1, 1 -> 2, -1 -> 0, 0x7fffffff -> 0
+//
+// Lines starting with # are comments. Expressions use C syntax and precedence with 32 bit wrapping arithmetic:
+// + - * / % & | ^ ~ << >> < <= > >= == != && || ! ?: and the functions abs(a), min(a, b) and max(a, b).
+struct TargetSpec
+{
+	std::string             name;
+	std::string             source;
+	TargetFn                func;
+	SimTargetFn             sim;
+
+	// when not empty the target is only defined for these inputs (an I/O table) so only these are used for the
+	// chains and the tests
+	std::vector<ValueType>  domain;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Returns false and sets error if the text could not be parsed
+bool ParseTargetExpression(const char* text, TargetFn& func, SimTargetFn& sim, std::string& error);
+bool ParseTargetTable(const char* text, TargetFn& func, std::vector<ValueType>& domain, std::string& error);
+
+// Read all the targets in a spec file, returns false after printing the first error
+bool LoadTargetSpecs(const char* path, std::vector<TargetSpec>& specs);
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  TARGET_H_HAS_BEEN_INCLUDED
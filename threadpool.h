@@ -0,0 +1,206 @@
+#ifndef		THREADPOOL_H_HAS_BEEN_INCLUDED
+#define		THREADPOOL_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+#include	<deque>
+#include	<memory>
+#include	<chrono>
+#include	<thread>
+#include	<mutex>
+#include	<condition_variable>
+#include	<functional>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A fixed size pool of worker threads with a work-stealing scheduler. Each worker has its own queue of jobs, jobs
+// submitted from a worker thread go on that worker's queue and jobs submitted from any other thread are distributed
+// round robin. When a worker's queue is empty it steals jobs from the other workers. Jobs are always taken from
+// the front of a queue so jobs submitted earlier (e.g. shorter program lengths) tend to run first.
+class ThreadPool
+{
+public:
+
+	using Job = std::function<void()>;
+
+	explicit ThreadPool(const int numThreads)
+	{
+		const int n = numThreads > 0 ? numThreads : 1;
+		for (int i = 0; i < n; i++)
+		{
+			queues_.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			threads_.push_back(std::thread([this, i]() { workerMain(i); }));
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			quit_ = true;
+		}
+
+		jobAvailable_.notify_all();
+		for (auto& thread: threads_)
+		{
+			thread.join();
+		}
+	}
+
+	void submit(Job job)
+	{
+		int queueIdx = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			queueIdx = currentPool() == this ? currentWorker() : (nextQueue_++ % size());
+			numPending_++;
+		}
+
+		{
+			WorkQueue& queue = *queues_[queueIdx];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+		}
+
+		{
+			// only counted once it is in a queue so a woken worker is always able to find it
+			std::lock_guard<std::mutex> lock(mutex_);
+			numQueued_++;
+		}
+
+		jobAvailable_.notify_one();
+	}
+
+	// Block until all the submitted jobs have completed, including any jobs submitted by the jobs themselves
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		jobsDone_.wait(lock, [this]() { return numPending_ == 0; });
+	}
+
+	// As wait() but gives up after the timeout, returns true if all the jobs have completed
+	bool waitFor(const std::chrono::milliseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		return jobsDone_.wait_for(lock, timeout, [this]() { return numPending_ == 0; });
+	}
+
+	int size() const
+	{
+		return static_cast<int>(threads_.size());
+	}
+
+	static int defaultNumThreads()
+	{
+		const int n = static_cast<int>(std::thread::hardware_concurrency());
+		return n > 0 ? n : 1;
+	}
+
+private:
+
+	struct WorkQueue
+	{
+		std::mutex          mutex;
+		std::deque<Job>     jobs;
+	};
+
+	static ThreadPool*& currentPool()
+	{
+		static thread_local ThreadPool* pool = nullptr;
+		return pool;
+	}
+
+	static int& currentWorker()
+	{
+		static thread_local int workerIdx = -1;
+		return workerIdx;
+	}
+
+	bool takeJob(const int queueIdx, Job& job)
+	{
+		WorkQueue& queue = *queues_[queueIdx];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+		{
+			return false;
+		}
+
+		job = std::move(queue.jobs.front());
+		queue.jobs.pop_front();
+		return true;
+	}
+
+	// Try the worker's own queue first and then try to steal from the others
+	bool findJob(const int workerIdx, Job& job)
+	{
+		for (int i = 0; i < size(); i++)
+		{
+			if (takeJob((workerIdx + i) % size(), job))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void workerMain(const int workerIdx)
+	{
+		currentPool() = this;
+		currentWorker() = workerIdx;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				jobAvailable_.wait(lock, [this]() { return quit_ || numQueued_ > 0; });
+				if (numQueued_ == 0)
+				{
+					return;
+				}
+			}
+
+			Job job;
+			if (!findJob(workerIdx, job))
+			{
+				// another worker got there first
+				std::this_thread::yield();
+				continue;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				numQueued_--;
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				numPending_--;
+			}
+
+			jobsDone_.notify_all();
+		}
+	}
+
+	std::vector<std::thread>                    threads_;
+	std::vector<std::unique_ptr<WorkQueue>>     queues_;
+	std::mutex                                  mutex_;
+	std::condition_variable                     jobAvailable_;
+	std::condition_variable                     jobsDone_;
+	int                                         nextQueue_ = 0;
+	int                                         numPending_ = 0;
+	int                                         numQueued_ = 0;
+	bool                                        quit_ = false;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  THREADPOOL_H_HAS_BEEN_INCLUDED
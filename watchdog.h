@@ -0,0 +1,119 @@
+#ifndef		WATCHDOG_H_HAS_BEEN_INCLUDED
+#define		WATCHDOG_H_HAS_BEEN_INCLUDED
+
+#include	<z3++.h>
+#include	<vector>
+#include	<chrono>
+#include	<thread>
+#include	<mutex>
+#include	<condition_variable>
+#include	<algorithm>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// Interrupts Z3 contexts which run past their deadline. A single thread sleeps until the earliest deadline of the
+// watched contexts and calls context::interrupt on each context whose deadline has passed, the interrupted check
+// returns unknown. This also catches checks which don't honour the solver's timeout parameter.
+class Watchdog
+{
+public:
+
+	using Clock = std::chrono::steady_clock;
+
+	Watchdog()
+		: thread_([this]() { watchMain(); })
+	{
+	}
+
+	~Watchdog()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			quit_ = true;
+		}
+
+		changed_.notify_all();
+		thread_.join();
+	}
+
+	Watchdog(const Watchdog&) = delete;
+	Watchdog& operator=(const Watchdog&) = delete;
+
+	// Returns an id to pass to unwatch, the context must be unwatched before it is destroyed
+	int watch(z3::context& ctx, const Clock::time_point deadline)
+	{
+		int id = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			id = nextId_++;
+			watched_.push_back(Watched { id, &ctx, deadline });
+		}
+
+		changed_.notify_all();
+		return id;
+	}
+
+	void unwatch(const int id)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		watched_.erase(std::remove_if(watched_.begin(), watched_.end(),
+			[id](const Watched& w) { return w.id == id; }), watched_.end());
+	}
+
+private:
+
+	struct Watched
+	{
+		int                 id;
+		z3::context*        ctx;
+		Clock::time_point   deadline;
+	};
+
+	void watchMain()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (!quit_)
+		{
+			const auto now = Clock::now();
+			auto next = Clock::time_point::max();
+			for (auto it = watched_.begin(); it != watched_.end(); )
+			{
+				if (it->deadline <= now)
+				{
+					// interrupted once, the caller sees unknown and doesn't check this context again
+					it->ctx->interrupt();
+					it = watched_.erase(it);
+					continue;
+				}
+
+				next = std::min(next, it->deadline);
+				++it;
+			}
+
+			if (next == Clock::time_point::max())
+			{
+				changed_.wait(lock);
+			}
+			else
+			{
+				changed_.wait_until(lock, next);
+			}
+		}
+	}
+
+	std::mutex                  mutex_;
+	std::condition_variable     changed_;
+	std::vector<Watched>        watched_;
+	int                         nextId_ = 0;
+	bool                        quit_ = false;
+
+	// declared last so everything it uses is constructed before the thread starts
+	std::thread                 thread_;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  WATCHDOG_H_HAS_BEEN_INCLUDED
@@ -0,0 +1,275 @@
+#include	"workers.h"
+
+#include	<stdio.h>
+#include	<algorithm>
+
+#ifndef _WIN32
+#include	<unistd.h>
+#include	<signal.h>
+#include	<poll.h>
+#include	<sys/wait.h>
+#endif
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+WorkerPool::WorkerPool(const int numWorkers, JobFn jobFn)
+	: jobFn_(jobFn)
+	, workers_(std::max(numWorkers, 1))
+{
+#ifndef _WIN32
+	// a worker which has been killed must not take the parent with it when its pipe is written to
+	signal(SIGPIPE, SIG_IGN);
+
+	for (Worker& worker: workers_)
+	{
+		spawn(worker);
+	}
+#endif
+}
+
+WorkerPool::~WorkerPool()
+{
+#ifndef _WIN32
+	for (Worker& worker: workers_)
+	{
+		kill(worker);
+	}
+#endif
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#ifdef _WIN32
+
+bool WorkerPool::spawn(Worker& worker)
+{
+	return true;
+}
+
+void WorkerPool::kill(Worker& worker)
+{
+}
+
+bool WorkerPool::run(const std::vector<std::string>& jobs, const ResultFn& onResult)
+{
+	for (int jobIdx = 0; jobIdx < static_cast<int>(jobs.size()); jobIdx++)
+	{
+		if (!onResult(jobIdx, jobFn_(jobs[jobIdx])))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#else
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool WorkerPool::spawn(Worker& worker)
+{
+	int toWorker[2];
+	int fromWorker[2];
+	if (pipe(toWorker) != 0)
+	{
+		return false;
+	}
+
+	if (pipe(fromWorker) != 0)
+	{
+		close(toWorker[0]);
+		close(toWorker[1]);
+		return false;
+	}
+
+	// otherwise anything buffered would be printed again by the worker
+	fflush(stdout);
+
+	const pid_t pid = fork();
+	if (pid == 0)
+	{
+		close(toWorker[1]);
+		close(fromWorker[0]);
+
+		// the pipes of the workers forked earlier were inherited, close them so a worker's pipe reaches end of file
+		// as soon as the parent closes it
+		for (const Worker& other: workers_)
+		{
+			if (&other != &worker && other.pid > 0)
+			{
+				close(other.toWorker);
+				close(other.fromWorker);
+			}
+		}
+
+		FILE* in = fdopen(toWorker[0], "r");
+		FILE* out = fdopen(fromWorker[1], "w");
+
+		std::string job;
+		int c = 0;
+		while ((c = fgetc(in)) != EOF)
+		{
+			if (c != '\n')
+			{
+				job += static_cast<char>(c);
+				continue;
+			}
+
+			const std::string result = jobFn_(job);
+			fprintf(out, "%s\n", result.c_str());
+			fflush(out);
+			job.clear();
+		}
+
+		// the parent's objects (threads, solver contexts) were copied by the fork and must not be destroyed here
+		_exit(0);
+	}
+
+	close(toWorker[0]);
+	close(fromWorker[1]);
+
+	if (pid < 0)
+	{
+		close(toWorker[1]);
+		close(fromWorker[0]);
+		return false;
+	}
+
+	worker.pid = pid;
+	worker.toWorker = toWorker[1];
+	worker.fromWorker = fromWorker[0];
+	worker.jobIdx = -1;
+	worker.received.clear();
+	return true;
+}
+
+void WorkerPool::kill(Worker& worker)
+{
+	if (worker.pid <= 0)
+	{
+		return;
+	}
+
+	close(worker.toWorker);
+	close(worker.fromWorker);
+	::kill(worker.pid, SIGKILL);
+	waitpid(worker.pid, nullptr, 0);
+
+	worker.pid = -1;
+	worker.jobIdx = -1;
+	worker.received.clear();
+}
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+bool WorkerPool::run(const std::vector<std::string>& jobs, const ResultFn& onResult)
+{
+	const int numJobs = static_cast<int>(jobs.size());
+	int nextJob = 0;
+	int numFinished = 0;
+	bool stopped = false;
+
+	while (!stopped && numFinished < numJobs)
+	{
+		// hand a job to every idle worker
+		for (Worker& worker: workers_)
+		{
+			if (worker.pid > 0 && worker.jobIdx < 0 && nextJob < numJobs)
+			{
+				const std::string line = jobs[nextJob] + "\n";
+				if (write(worker.toWorker, line.data(), line.size()) != static_cast<ssize_t>(line.size()))
+				{
+					stopped = true;
+					break;
+				}
+
+				worker.jobIdx = nextJob++;
+			}
+		}
+
+		std::vector<pollfd> fds;
+		std::vector<Worker*> busy;
+		for (Worker& worker: workers_)
+		{
+			if (worker.pid > 0 && worker.jobIdx >= 0)
+			{
+				fds.push_back(pollfd { worker.fromWorker, POLLIN, 0 });
+				busy.push_back(&worker);
+			}
+		}
+
+		if (stopped || fds.empty())
+		{
+			stopped = true;
+			break;
+		}
+
+		if (poll(fds.data(), fds.size(), -1) < 0)
+		{
+			stopped = true;
+			break;
+		}
+
+		for (size_t i = 0; i < fds.size() && !stopped; i++)
+		{
+			if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+			{
+				continue;
+			}
+
+			Worker& worker = *busy[i];
+			char buffer[4096];
+			const ssize_t n = read(worker.fromWorker, buffer, sizeof(buffer));
+			if (n <= 0)
+			{
+				// the worker died in the middle of the job (e.g. the solver aborted), replace it and report the job
+				// with an empty result
+				const int jobIdx = worker.jobIdx;
+				kill(worker);
+				spawn(worker);
+				numFinished++;
+				stopped = !onResult(jobIdx, std::string());
+				continue;
+			}
+
+			worker.received.append(buffer, n);
+			const size_t eol = worker.received.find('\n');
+			if (eol == std::string::npos)
+			{
+				continue;
+			}
+
+			const int jobIdx = worker.jobIdx;
+			const std::string result = worker.received.substr(0, eol);
+			worker.received.erase(0, eol + 1);
+			worker.jobIdx = -1;
+			numFinished++;
+
+			stopped = !onResult(jobIdx, result);
+		}
+	}
+
+	if (stopped)
+	{
+		for (Worker& worker: workers_)
+		{
+			if (worker.pid <= 0 || worker.jobIdx >= 0)
+			{
+				kill(worker);
+				spawn(worker);
+			}
+		}
+	}
+
+	return !stopped;
+}
+
+#endif
+
+// ====================================================================================================================
+// ====================================================================================================================
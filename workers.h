@@ -0,0 +1,61 @@
+#ifndef		WORKERS_H_HAS_BEEN_INCLUDED
+#define		WORKERS_H_HAS_BEEN_INCLUDED
+
+#include	<vector>
+#include	<string>
+#include	<functional>
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+// A pool of forked worker processes. A job is a line of text written to a worker's input pipe and the worker replies
+// with a line of text on its output pipe, so everything a worker needs has to be in the job or in the state it was
+// forked with. Nothing else is shared, the same protocol can be run over a socket to workers on other hosts.
+//
+// Each worker is a separate process so a check which runs for hours only ties up one core and can be stopped by
+// killing the process. Windows has no fork so there the jobs are run one after another in this process.
+class WorkerPool
+{
+public:
+
+	using JobFn = std::function<std::string(const std::string& job)>;
+
+	// Called in the parent as each job finishes, return false to stop the remaining jobs. A worker which dies during a
+	// job is replaced and the job's result is empty.
+	using ResultFn = std::function<bool(const int jobIdx, const std::string& result)>;
+
+	// jobFn is run in the workers, it and everything it refers to must be set up before the pool is created
+	WorkerPool(const int numWorkers, JobFn jobFn);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	int size() const { return static_cast<int>(workers_.size()); }
+
+	// Runs the jobs on the workers and calls onResult as each one finishes. Returns false if onResult stopped the run, 
+	// the workers still running a job are then killed and replaced so the pool can be used again.
+	bool run(const std::vector<std::string>& jobs, const ResultFn& onResult);
+
+private:
+
+	struct Worker
+	{
+		int                 pid = -1;
+		int                 toWorker = -1;
+		int                 fromWorker = -1;
+		int                 jobIdx = -1;
+		std::string         received;
+	};
+
+	bool spawn(Worker& worker);
+	void kill(Worker& worker);
+
+	JobFn                   jobFn_;
+	std::vector<Worker>     workers_;
+};
+
+// ====================================================================================================================
+// ====================================================================================================================
+
+#endif //  WORKERS_H_HAS_BEEN_INCLUDED